@@ -8,20 +8,31 @@ Notation::Notation() :
     scoreWidth (8),
     ppi (100),
     dimInches (10, 10),
-    score (spaceHeight, tabSpaceRatio, staffDistance, scoreWidth)
+    lastPaintTime (0.0),
+    score (spaceHeight, tabSpaceRatio, staffDistance, scoreWidth),
+    hasPage (false),
+    tileGeneration (0)
 {
 }
 
 Notation::~Notation()
 {
+    if (tileRenderer != nullptr)
+        tileRenderer->stopThread (5000);
 }
 
 void Notation::paint (juce::Graphics& g)
 {
+    const double paintStart = juce::Time::getMillisecondCounterHiRes();
+
     g.fillAll (juce::Colours::white);
 
     // paint the score
-    if (score.Canvases.n() > 0)
+    if (tileRenderer != nullptr)
+    {
+        paintTiles (g);
+    }
+    else if (score.Canvases.n() > 0)
     {
         belle::painters::JUCE painter;
         belle::painters::JUCE::Properties properties;
@@ -31,38 +42,97 @@ void Notation::paint (juce::Graphics& g)
         properties.IndexOfCanvas = 0;
         properties.PageDimensions = belle::Inches (prim::number (dimInches.x), prim::number (dimInches.y));
         properties.PageArea = prim::planar::RectangleInt (0, 0, prim::integer (getWidth()), prim::integer (getHeight()));
-        properties.PageVisibility = properties.PageArea;
+        properties.PageVisibility = toPageVisibility (g.getClipBounds(), getHeight());
 
         painter.Paint (&score, &properties);
     }    
+
+    lastPaintTime = juce::Time::getMillisecondCounterHiRes() - paintStart;
 }
 
 void Notation::resized()
 {
     dimInches.x = ((double)getWidth() / ppi);
     dimInches.y = ((double)getHeight() / ppi);
+    invalidateTiles();
 }
 
 //==============================================================================
 void Notation::setScoreWidth (int widthInPixels) noexcept
 {
     scoreWidth = NotationHelper::pixelsToInches (widthInPixels, ppi);
-    score.setSystemWidth (scoreWidth);
+    discardPendingTiles();
+    {
+        const juce::ScopedLock sl (scoreLock);
+        score.setSystemWidth (scoreWidth);
+        snapshotLayout();
+    }
     resized();
     repaint();
 }
 
+double Notation::getLastPaintTime() const noexcept
+{
+    return lastPaintTime;
+}
+
+void Notation::setTileCacheEnabled (bool shouldCacheTiles)
+{
+    if (shouldCacheTiles == isTileCacheEnabled())
+        return;
+
+    if (shouldCacheTiles)
+    {
+        tileRenderer = new TileRenderer (*this);
+        invalidateTiles();
+        tileRenderer->startThread();
+    }
+    else
+    {
+        tileRenderer->stopThread (5000);
+        tileRenderer = nullptr;
+        cancelPendingUpdate();
+
+        const juce::ScopedLock tl (tileLock);
+        tiles.clear();
+        ++tileGeneration;
+    }
+
+    repaint();
+}
+
+bool Notation::isTileCacheEnabled() const noexcept
+{
+    return tileRenderer != nullptr;
+}
+
 bool Notation::loadXMLFile (const juce::File& file)
 {          
-    if (score.loadXMLFile (file))
+    bool loaded;
+    discardPendingTiles();
     {
-        initializeScoreCanvas();
-        return true;
+        const juce::ScopedLock sl (scoreLock);
+        loaded = score.loadXMLFile (file);
+        if (loaded)
+        {
+            initializeScoreCanvas();
+            snapshotLayout();
+        }
     }
-    return false;
+
+    if (loaded)
+        invalidateTiles();
+    return loaded;
 }
 
 //==============================================================================
+prim::planar::RectangleInt Notation::toPageVisibility (const juce::Rectangle<int>& clip, int height)
+{
+    // The painter measures the visible area from the bottom-left corner.
+    return prim::planar::RectangleInt (prim::integer (clip.getX()), prim::integer (height - clip.getBottom()),
+                                       prim::integer (clip.getRight()), prim::integer (height - clip.getY()));
+}
+
 void Notation::initializeScoreCanvas()
 {
     score.Canvases.RemoveAndDeleteAll();
@@ -72,3 +142,180 @@ void Notation::initializeScoreCanvas()
     Score::Page* page = dynamic_cast<Score::Page*> (score.Canvases.z());
     page->offsetFromOrigin = (belle::Inches (1.0, ((score.getSystems()->ith(0).SystemHeight - score.getSystems()->ith(0).StaffHeights[0]) * spaceHeight) - 1.0));
 }
+
+//==============================================================================
+Notation::TileRenderer::TileRenderer (Notation& owner_)
+    : juce::Thread ("Notation tile renderer"),
+      owner (owner_)
+{
+}
+
+void Notation::TileRenderer::run()
+{
+    while (! threadShouldExit())
+    {
+        owner.renderTiles();
+        wait (-1);
+    }
+}
+
+// Copies the system layout for invalidateTiles; called with scoreLock held after typesetting.
+void Notation::snapshotLayout()
+{
+    Score::Page* page = score.Canvases.n() > 0 ? dynamic_cast<Score::Page*> (score.Canvases.z()) : nullptr;
+    prim::List<belle::modern::System>* systems = score.getSystems();
+
+    juce::Array<prim::planar::Rectangle> newBounds;
+    for (prim::count i = 0; page != nullptr && i < systems->n(); ++i)
+        newBounds.add (systems->ith (i).Bounds);
+
+    const juce::ScopedLock ll (layoutLock);
+    systemBounds.swapWithArray (newBounds);
+    hasPage = page != nullptr;
+    if (page != nullptr)
+        pageOffset = page->offsetFromOrigin;
+}
+
+// Stops the renderer from copying systems for the current tiles before the score is retypeset.
+void Notation::discardPendingTiles()
+{
+    const juce::ScopedLock tl (tileLock);
+    ++tileGeneration;
+}
+
+void Notation::invalidateTiles()
+{
+    if (tileRenderer == nullptr)
+        return;
+
+    // Lay out a tile for each system, in the same way Score::Page paints them.
+    // Only the layout snapshot is locked here, so this never waits for a tile to render.
+    juce::Array<Tile> newTiles;
+    {
+        const juce::ScopedLock ll (layoutLock);
+        const int padding = 2;
+
+        // Distance in inches from the top of the component to the bottom-left of the system
+        double distance = -pageOffset.y;
+
+        for (int i = 0; hasPage && i < systemBounds.size(); ++i)
+        {
+            const prim::planar::Rectangle& bounds = systemBounds.getReference (i);
+            distance += bounds.Height() * spaceHeight;
+
+            Tile tile;
+            tile.top = (int) std::floor ((distance - bounds.Top() * spaceHeight) * ppi) - padding;
+            tile.width = getWidth();
+            tile.height = (int) std::ceil ((distance - bounds.Bottom() * spaceHeight) * ppi) + padding - tile.top;
+            if (bounds.IsEmpty())
+                tile.height = 0;
+            tile.bottomLeft = prim::planar::Vector (pageOffset.x,
+                                                    (tile.height - (distance * ppi - tile.top)) / ppi);
+            newTiles.add (tile);
+        }
+    }
+
+    {
+        const juce::ScopedLock tl (tileLock);
+        tiles.swapWithArray (newTiles);
+        ++tileGeneration;
+    }
+
+    tileRenderer->notify();
+    repaint();
+}
+
+void Notation::renderTiles()
+{
+    while (! tileRenderer->threadShouldExit())
+    {
+        // Find the next tile that has not been rendered yet.
+        int index = -1;
+        int generation;
+        Tile tile;
+        {
+            const juce::ScopedLock tl (tileLock);
+            for (int i = 0; i < tiles.size() && index < 0; ++i)
+            {
+                const Tile& t = tiles.getReference (i);
+                if (! t.image.isValid() && t.width > 0 && t.height > 0)
+                {
+                    index = i;
+                    tile = t;
+                }
+            }
+            generation = tileGeneration;
+        }
+
+        if (index < 0)
+            return;
+
+        // Copy the system under the score lock and render the copy without it,
+        // so that retypesetting the score never waits for a tile to render.
+        belle::modern::System system;
+        {
+            const juce::ScopedLock sl (scoreLock);
+            {
+                // The score may have been retypeset while waiting for the lock.
+                const juce::ScopedLock tl (tileLock);
+                if (generation != tileGeneration)
+                    continue;
+            }
+
+            // The tiles have not been laid out for the new systems yet; invalidateTiles will wake the renderer.
+            prim::List<belle::modern::System>* systems = score.getSystems();
+            if (index >= systems->n())
+                return;
+
+            system.DeepCopyFrom (systems->ith (index));
+        }
+
+        juce::Image image (juce::Image::ARGB, tile.width, tile.height, true);
+        {
+            juce::Graphics g (image);
+            belle::Portfolio portfolio;
+            portfolio.Canvases.Add() = new Score::SystemTile (system, score.getSpaceHeight(), score.getTabSpaceRatio(), tile.bottomLeft);
+            portfolio.Canvases.z()->Dimensions = belle::Inches (prim::number (tile.width) / ppi, prim::number (tile.height) / ppi);
+
+            belle::painters::JUCE painter;
+            belle::painters::JUCE::Properties properties;
+
+            properties.GraphicsContext = &g;
+            properties.IndexOfCanvas = 0;
+            properties.PageDimensions = portfolio.Canvases.z()->Dimensions;
+            properties.PageArea = prim::planar::RectangleInt (0, 0, prim::integer (tile.width), prim::integer (tile.height));
+            properties.PageVisibility = toPageVisibility (g.getClipBounds(), tile.height);
+            properties.TargetSize = prim::planar::VectorInt (prim::integer (tile.width), prim::integer (tile.height));
+
+            painter.Paint (&portfolio, &properties);
+            portfolio.Canvases.RemoveAndDeleteAll();
+        }
+
+        {
+            const juce::ScopedLock tl (tileLock);
+            if (generation == tileGeneration)
+                tiles.getReference (index).image = image;
+        }
+
+        triggerAsyncUpdate();
+    }
+}
+
+void Notation::paintTiles (juce::Graphics& g)
+{
+    const juce::Rectangle<int> clip (g.getClipBounds());
+
+    // Only blit the tiles here; rendering happens on the tile renderer thread.
+    const juce::ScopedLock tl (tileLock);
+    for (int i = 0; i < tiles.size(); ++i)
+    {
+        const Tile& tile = tiles.getReference (i);
+        if (tile.image.isValid() && clip.intersects (juce::Rectangle<int> (0, tile.top, tile.width, tile.height)))
+            g.drawImageAt (tile.image, 0, tile.top);
+    }
+}
+
+void Notation::handleAsyncUpdate()
+{
+    repaint();
+}
@@ -3,7 +3,8 @@
 
 #include "Score.h"
 
-class Notation : public juce::Component
+class Notation : public juce::Component,
+                 private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -24,6 +25,22 @@ public:
     */
     bool loadXMLFile (const juce::File& file);
 
+    /**
+    * Returns the time taken by the most recent paint of the score in milliseconds.
+    */
+    double getLastPaintTime() const noexcept;
+
+    /**
+    * Enables or disables the tile cache. When enabled, each system is rendered
+    * to an image on a background thread and paint only draws the visible images.
+    */
+    void setTileCacheEnabled (bool shouldCacheTiles);
+
+    /**
+    * Returns true if the tile cache is enabled.
+    */
+    bool isTileCacheEnabled() const noexcept;
+
 private:
     //==============================================================================
     int ppi; //< Pixels per inch
@@ -35,11 +52,57 @@ private:
 
     juce::Point<double> dimInches; //< Dimensions of component in inches
 
+    double lastPaintTime;   //< Time taken by the most recent paint in milliseconds
+
     Score score;
+
+    //==============================================================================
+    /** A system rendered to an image, positioned in component pixels. */
+    struct Tile
+    {
+        int top;                        //< Top of the tile in pixels
+        int width;                      //< Width of the tile in pixels
+        int height;                     //< Height of the tile in pixels
+        prim::planar::Vector bottomLeft; //< Position of the system within the tile in inches
+        juce::Image image;              //< The rendered system, or invalid if not yet rendered
+    };
+
+    /** Renders tiles in the background whenever they are invalidated. */
+    class TileRenderer : public juce::Thread
+    {
+    public:
+        TileRenderer (Notation& owner);
+        void run();
+
+    private:
+        Notation& owner;
+    };
+
+    juce::CriticalSection scoreLock; //< Held while the score is typeset or a system is copied for a tile
+    juce::CriticalSection layoutLock; //< Guards the layout snapshot; never held while rendering
+    juce::Array<prim::planar::Rectangle> systemBounds; //< Bounds of each system when last typeset
+    belle::Inches pageOffset;       //< Offset of the page when last typeset
+    bool hasPage;                   //< Whether the score had a page when last typeset
+    juce::CriticalSection tileLock;  //< Guards the tiles and their generation
+    juce::Array<Tile> tiles;
+    int tileGeneration;             //< Incremented each time the tiles are invalidated
+    juce::ScopedPointer<TileRenderer> tileRenderer;
        
     //==============================================================================
     void initializeScoreCanvas();
 
+    /**
+    * Converts a clip region in component pixels to the painter's page visibility,
+    * which has its origin at the bottom-left of an area of the given height.
+    */
+    static prim::planar::RectangleInt toPageVisibility (const juce::Rectangle<int>& clip, int height);
+    void snapshotLayout();
+    void discardPendingTiles();
+    void invalidateTiles();
+    void renderTiles();
+    void paintTiles (juce::Graphics& g);
+    void handleAsyncUpdate();
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Notation)
 };
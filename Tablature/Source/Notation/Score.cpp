@@ -7,23 +7,24 @@ Score::Score (prim::number _spaceHeight, prim::number _tabSpaceRatio, prim::numb
     tabSpaceRatio (_tabSpaceRatio),
     staffDistance (_staffDistance),
     systemWidth (widthInInches),
-    systemWidthSpaces (systemWidth / spaceHeight)
+    systemWidthSpaces (systemWidth / spaceHeight),
+    phaseTimes()
 {
-    //Import notation font
-    scoreFont.Add (belle::Font::Special1)->ImportFromArray ((prim::byte*)Resources::joie_bellefont);
+    const double importStart = juce::Time::getMillisecondCounterHiRes();
+
+    //Import notation font, parsing its glyphs only when they are first needed
+    scoreFont.Add (belle::Font::Special1)->ImportFromArrayOnDemand ((prim::byte*)Resources::joie_bellefont);
 
     //Import text font
     prim::String Regular = "../../Fonts/GentiumBasicRegular.bellefont";
-    prim::Array<prim::byte> a;
-    if(prim::File::Read(Regular, a))
-        scoreFont.Add(belle::Font::Regular)->ImportFromArray(&a.a());
-    else /// If running on Mac using XCode, path to font file is different
+    if (! importTextFont (Regular)) /// If running on Mac using XCode, path to font file is different
     {
         Regular = "../../../../Fonts/GentiumBasicRegular.bellefont";
-        if(prim::File::Read(Regular, a))
-            scoreFont.Add(belle::Font::Regular)->ImportFromArray(&a.a());
+        importTextFont (Regular);
     }
 
+    phaseTimes.fontImport = juce::Time::getMillisecondCounterHiRes() - importStart;
+
     houseStyle.SpaceHeight = spaceHeight;
     houseStyle.TabSpaceHeightRatio = tabSpaceRatio;
     houseStyle.StaffDistance = staffDistance;
@@ -33,6 +34,27 @@ Score::~Score()
 {
 }
 
+bool Score::importTextFont (const prim::String& filename)
+{
+    // Import into a local typeface so that a failed import adds nothing to the font
+    juce::ScopedPointer<belle::Typeface> textTypeface (new belle::Typeface);
+
+#ifdef PRIM_WITH_MEMORY_MAP
+    // Map the file so that a mappable font is shared between processes and used in place
+    if (prim::File::Length (filename) <= 0 || ! textTypeface->ImportFromMappedFile (filename))
+        return false;
+#else
+    prim::Array<prim::byte> a;
+    if (! prim::File::Read (filename, a))
+        return false;
+
+    textTypeface->ImportFromArray (&a.a());
+#endif
+
+    scoreFont.Add (belle::Font::Regular, textTypeface.release());
+    return true;
+}
+
 bool Score::loadXMLFile (const juce::File& file)
 {
     juce::String xmlString = file.loadFileAsString();
@@ -54,16 +76,27 @@ bool Score::loadXMLFile (const juce::File& file)
 
 void Score::createSystems()
 {
+    const double cacheStart = juce::Time::getMillisecondCounterHiRes();
+
     // Create the Cache and get the Notation Typeface
     const belle::Typeface& typeface = createCache();
 
+    const double initializeStart = juce::Time::getMillisecondCounterHiRes();
+
     // Initialize the piece and the systems
     prim::Array<belle::graph::ExtraStaff> primExtraStaves;
     for (int i = 0; i < extraStaves.size(); ++i)
         primExtraStaves.Add (extraStaves.getUnchecked (i));
 
     piece.Initialize (musicGraph, primExtraStaves, houseStyle, cache, typeface, scoreFont);    
+
+    const double prepareStart = juce::Time::getMillisecondCounterHiRes();
     piece.Prepare (systems, systemWidth, systemWidth);
+    const double prepareEnd = juce::Time::getMillisecondCounterHiRes();
+
+    phaseTimes.cache = initializeStart - cacheStart;
+    phaseTimes.initialize = prepareStart - initializeStart;
+    phaseTimes.prepare = prepareEnd - prepareStart;
 }
 
 prim::List<belle::modern::System>* Score::getSystems() noexcept
@@ -89,11 +122,16 @@ prim::number Score::getTabSpaceRatio() const noexcept
     return tabSpaceRatio;
 }
 
+const Score::PhaseTimes& Score::getPhaseTimes() const noexcept
+{
+    return phaseTimes;
+}
+
 const belle::Typeface& Score::createCache()
 {
     const belle::Typeface& notationTypeface = *scoreFont[0];
-    
-    cache.ClearAndDeleteAll();
+
+    // Only rebuilds the cached paths if the house style or typeface has changed
     cache.Create (houseStyle, notationTypeface);
 
     return notationTypeface;
@@ -47,6 +47,21 @@ public:
     */
     prim::number getTabSpaceRatio() const noexcept;
 
+    /** Times taken by the phases of loading and laying out the score in milliseconds. */
+    struct PhaseTimes
+    {
+        double fontImport;  //< Importing the notation and text fonts
+        double cache;       //< Creating the cached notation paths
+        double initialize;  //< Initializing the piece
+        double prepare;     //< Laying out the systems
+    };
+
+    /**
+    * Returns the phase times of the font import in the constructor and of the
+    * most recent call to createSystems
+    */
+    const PhaseTimes& getPhaseTimes() const noexcept;
+
     //==============================================================================
     struct Page : public belle::Canvas
     {
@@ -69,6 +84,29 @@ public:
         }
     };
 
+    /**
+    * A canvas containing a single system, used to render the system on its own
+    * (for example to an image tile). The system may be a copy of one of the
+    * score's systems, so that it can be painted without locking the score.
+    */
+    struct SystemTile : public belle::Canvas
+    {
+        belle::modern::System& system;
+        prim::number spaceHeight;
+        prim::number tabSpaceRatio;
+        prim::planar::Vector bottomLeft; //< Position of the system in inches
+
+        SystemTile (belle::modern::System& s, prim::number spaceHeight_, prim::number tabSpaceRatio_, prim::planar::Vector position)
+            : system (s), spaceHeight (spaceHeight_), tabSpaceRatio (tabSpaceRatio_), bottomLeft (position)
+        {
+        }
+
+        virtual void Paint (belle::Painter& Painter, Portfolio&)
+        {
+            system.Paint (Painter, bottomLeft, spaceHeight, tabSpaceRatio);
+        }
+    };
+
 private:
     //==============================================================================
     prim::number spaceHeight;
@@ -88,9 +126,18 @@ private:
     juce::Array<belle::graph::ExtraStaff> extraStaves;
     belle::graph::ExtraStaff::ExtraStaffSortingComparator extraStaffComparator;
 
+    PhaseTimes phaseTimes;
+
     //==============================================================================
     const belle::Typeface& createCache();
 
+    /**
+    * Adds the text font from a bellefont file. Mappable fonts are used in place
+    * when prim is built with PRIM_WITH_MEMORY_MAP. Returns false if the file
+    * could not be read.
+    */
+    bool importTextFont (const prim::String& filename);
+
     /**
     * Determines the extra staves if any by looking for any StringedInstrument parts 
     * whose display setting is STANDARD_AND_TAB
@@ -81,9 +81,17 @@
 //The modern library...
 #include "Source/Modern/Modern.h"
 
+/*The PDF and PNG painters compress their streams with zlib when it is
+available. Otherwise the PDF painter uses JUCE and the PNG painter stores the
+data uncompressed. To use zlib without JUCE:
+1) Add include path to zlib (i.e. the copy in juce_core/zip/zlib)
+2) Link to zlib or compile its sources
+3) Define BELLEBONNESAGE_WITH_ZLIB*/
+
 //The painters...
 #include "Source/Painters/JUCE.h"
 #include "Source/Painters/PDF.h"
+#include "Source/Painters/PNG.h"
 #include "Source/Painters/SVG.h"
 
 /*FreeType2 requires a little bit of configuration so it is optional.
@@ -290,6 +290,9 @@ namespace bellebonnesage
       }
     }
     
+    //Rebuild the kerning lookup now that the kerning pairs are known.
+    UpdateLookup();
+    
     //Return detailed information on what failed.
     if(NumberNotLoaded > 0 || NumberNotInOutlineFormat > 0 ||
       NumberGetGlyphFails > 0 || NumberDecomposeFails > 0)
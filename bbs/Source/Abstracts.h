@@ -112,6 +112,171 @@ namespace bellebonnesage
     virtual prim::planar::VectorInt GetSize() const = 0;
   };
 
+  /**Least-recently-used cache of text laid out to paths. Laying out text
+  involves breaking it into words and lines and typesetting each character, so
+  strings that are drawn many times (such as fret numbers and time signatures)
+  are laid out once and the path is shared from then on. Entries refer to the
+  font by its address, so the cache should be cleared if a font is destroyed
+  while the cache is in use.*/
+  class TextLayoutCache
+  {
+    ///A laid out path along with the key that identifies it.
+    struct Entry
+    {
+      ///Key made from the string and the layout parameters.
+      prim::String Key;
+      
+      ///The laid out text.
+      Path Layout;
+      
+      ///Value of the use counter when the entry was last used.
+      prim::count LastUsed;
+      
+      Entry() : LastUsed(0) {}
+    };
+    
+    ///The cached entries.
+    prim::Array<Entry> Entries;
+    
+    ///Index of the entry for each key.
+    prim::Table<prim::String, prim::count> Index;
+    
+    ///Maximum number of entries to keep.
+    prim::count Capacity;
+    
+    ///Counter incremented on each use to order the entries by recency.
+    prim::count Uses;
+    
+#ifdef PRIM_WITH_THREAD
+    /**Protects the cache when text is laid out on more than one thread. The
+    cached paths never share geometry with paths outside the cache, so the
+    lock covers every use of them.*/
+    prim::Mutex CacheMutex;
+#endif
+
+    ///Appends the bytes of a value to a key as hexadecimal digits.
+    static void AppendToKey(prim::String& Key, const void* Value,
+      prim::count Bytes)
+    {
+      static const prim::ascii Digits[] = "0123456789abcdef";
+      prim::ascii Hex[32];
+      const prim::byte* v = (const prim::byte*)Value;
+      Bytes = prim::Min(Bytes, (prim::count)16);
+      for(prim::count i = 0; i < Bytes; i++)
+      {
+        Hex[i * 2] = Digits[v[i] >> 4];
+        Hex[i * 2 + 1] = Digits[v[i] & 15];
+      }
+      Key.Append((const prim::byte*)Hex, Bytes * 2);
+    }
+    
+    public:
+    
+    ///Creates a cache holding up to the given number of entries.
+    TextLayoutCache(prim::count Capacity = 256) : Index(-1),
+      Capacity(Capacity), Uses(0) {}
+    
+    ///Returns the cache shared by the painters and engravers.
+    static TextLayoutCache& Shared()
+    {
+      static TextLayoutCache Cache;
+      return Cache;
+    }
+    
+    ///Makes the key identifying a string laid out with the given parameters.
+    static prim::String MakeKey(const prim::String& TextToDraw,
+      const Font& FontToUse, prim::number PointSize, Font::Style Style,
+      Text::Justification Justify, prim::number LineWidth)
+    {
+      prim::String Key = TextToDraw;
+      Key << "|";
+      const Font* FontAddress = &FontToUse;
+      prim::count StyleValue = (prim::count)Style;
+      AppendToKey(Key, &FontAddress, sizeof(FontAddress));
+      
+      /*Include the typeface generations so that layouts are not reused once
+      the font is destroyed or its typefaces are re-imported.*/
+      for(prim::count i = 0; i < FontToUse.n(); i++)
+      {
+        prim::count Generation = FontToUse.ith(i)->Generation();
+        AppendToKey(Key, &Generation, sizeof(Generation));
+      }
+      AppendToKey(Key, &PointSize, sizeof(PointSize));
+      AppendToKey(Key, &StyleValue, sizeof(StyleValue));
+      AppendToKey(Key, &Justify, sizeof(Justify));
+      AppendToKey(Key, &LineWidth, sizeof(LineWidth));
+      return Key;
+    }
+    
+    /**Looks up the laid out path for a key. Returns whether it was found, in
+    which case the layout is a copy of the cached path.*/
+    bool Find(const prim::String& Key, Path& Layout)
+    {
+#ifdef PRIM_WITH_THREAD
+      prim::Lock Lock(CacheMutex);
+#endif
+      prim::count i = Index[Key];
+      if(i < 0)
+        return false;
+      Entries[i].LastUsed = ++Uses;
+      Layout.CopyFrom(Entries[i].Layout);
+      return true;
+    }
+    
+    /**Stores a copy of the laid out path for a key. If the cache is full then
+    the least recently used entry is replaced.*/
+    void Store(const prim::String& Key, const Path& Layout)
+    {
+#ifdef PRIM_WITH_THREAD
+      prim::Lock Lock(CacheMutex);
+#endif
+      if(Capacity <= 0)
+        return;
+      
+      prim::count i = Index[Key];
+      if(i < 0)
+      {
+        if(Entries.n() < Capacity)
+        {
+          i = Entries.n();
+          Entries.Add();
+        }
+        else
+        {
+          i = 0;
+          for(prim::count j = 1; j < Entries.n(); j++)
+            if(Entries[j].LastUsed < Entries[i].LastUsed)
+              i = j;
+          
+          //Remove the evicted key; counting the table prunes it.
+          Index[Entries[i].Key] = -1;
+          Index.n();
+        }
+        Entries[i].Key = Key;
+        Index[Key] = i;
+      }
+      Entries[i].Layout.CopyFrom(Layout);
+      Entries[i].LastUsed = ++Uses;
+    }
+    
+    ///Removes all the entries from the cache.
+    void Clear()
+    {
+#ifdef PRIM_WITH_THREAD
+      prim::Lock Lock(CacheMutex);
+#endif
+      Entries.Clear();
+      Index.Clear();
+      Uses = 0;
+    }
+    
+    ///Returns the number of entries in the cache.
+    prim::count n() const
+    {
+      return Entries.n();
+    }
+  };
+
   class Painter
   {
     //------------//
@@ -343,6 +508,16 @@ namespace bellebonnesage
     {
       return Spaces;
     }
+    
+    /**Returns whether a rectangle in the current space may be visible. Painters
+    which only show part of a page can override this so that whole groups of
+    objects outside of the view can be skipped before they are drawn. By
+    default everything is considered visible.*/
+    virtual bool IsVisible(const prim::planar::Rectangle& Bounds)
+    {
+      (void)Bounds;
+      return true;
+    }
 
     //-----//
     //Paths//
@@ -354,6 +529,15 @@ namespace bellebonnesage
     specific rendering.*/
     virtual void Draw(const Path& p, const Affine& a = Affine::Unit()) = 0;
     
+    /**Draws a path that is shared by many graphics, such as a cached path or a
+    glyph. The path must not change or be destroyed while the portfolio is
+    being painted, so a painter may write it once and refer back to it on each
+    subsequent draw. By default the path is simply drawn.*/
+    virtual void DrawShared(const Path& p, const Affine& a = Affine::Unit())
+    {
+      Draw(p, a);
+    }
+    
     //------//
     //Images//
     //------//
@@ -401,7 +585,7 @@ namespace bellebonnesage
             Translate(c.TypesetPosition);
             Scale(c.PointSize / 72.0);
             SetFill(c.FaceColor);
-            Draw(*g);
+            DrawShared(*g);
             Revert(2);
           }
         }
@@ -449,7 +633,9 @@ namespace bellebonnesage
       Draw(t, a);
     }
     
-    ///Typeset and draw text to path.
+    /**Typeset and draw text to path. The layout is looked up in the shared
+    text layout cache, so a string is only typeset the first time it is drawn
+    with a given font, size, style, and justification.*/
     static void Draw(Path& p, prim::String TextToDraw, const Font& FontToUse,
       prim::number PointSize = 12.0,
       Font::Style Style = Font::Regular,
@@ -459,31 +645,43 @@ namespace bellebonnesage
       //Make a long line if no line width is provided.
       if(!LineWidth)
         LineWidth = 10.0;
-      Text t(FontToUse, Style, PointSize, LineWidth, Justify);
       
-      //Import the string.
-      t.ImportStringToWords(TextToDraw);
-      
-      //Set the styling for each character.
-      for(prim::count i = 0; i < t.Words.n(); i++)
+      //Use the cached layout if the text has been typeset before.
+      prim::String Key = TextLayoutCache::MakeKey(TextToDraw, FontToUse,
+        PointSize, Style, Justify, LineWidth);
+      Path Layout;
+      if(!TextLayoutCache::Shared().Find(Key, Layout))
       {
-        Word& w = t.Words[i];
-        for(prim::count j = 0; j < w.n(); j++)
+        Text t(FontToUse, Style, PointSize, LineWidth, Justify);
+        
+        //Import the string.
+        t.ImportStringToWords(TextToDraw);
+        
+        //Set the styling for each character.
+        for(prim::count i = 0; i < t.Words.n(); i++)
         {
-          Character& l = w[j];
-          l.PointSize = PointSize;
-          l.Style = Style;
+          Word& w = t.Words[i];
+          for(prim::count j = 0; j < w.n(); j++)
+          {
+            Character& l = w[j];
+            l.PointSize = PointSize;
+            l.Style = Style;
+          }
         }
+        
+        //Determine the line breaks.
+        t.DetermineLineBreaks();
+        
+        //Typeset the text.
+        t.Typeset();
+        
+        //Draw the text and remember its layout.
+        Draw(t, Layout);
+        TextLayoutCache::Shared().Store(Key, Layout);
       }
       
-      //Determine the line breaks.
-      t.DetermineLineBreaks();
-      
-      //Typeset the text.
-      t.Typeset();
-      
-      //Draw the text.
-      Draw(t, p);
+      //Draw the layout, sharing its geometry if the path is empty.
+      p.Append(Layout);
     }
   };
 
@@ -130,6 +130,221 @@ namespace bellebonnesage
     table before sorting again.*/
     mutable bool GlyphTableIsSorted;
     
+    ///Identifies the current contents of the typeface.
+    prim::count ContentGeneration;
+    
+    ///Returns a generation number that no typeface has used yet.
+    static prim::count NextGeneration()
+    {
+      static prim::count Generations = 0;
+#ifdef PRIM_WITH_THREAD
+      /*The mutex is never deleted so that typefaces destroyed during static
+      destruction can still use it.*/
+      static prim::Mutex* GenerationMutex = new prim::Mutex;
+      prim::Lock Lock(*GenerationMutex);
+#endif
+      return ++Generations;
+    }
+    
+    ///Number of characters covered by each page of the direct lookup.
+    static const prim::count LookupPageSize = 256;
+    
+    /**Characters below this are looked up directly. This covers the Basic
+    Multilingual Plane including the private use area used by music fonts.*/
+    static const prim::unicode DirectLookupLimit = 0x10000;
+    
+    /**Offset of each page of characters in the direct lookup or -1 if the
+    typeface has no glyphs on that page.*/
+    mutable prim::Array<prim::count> LookupPages;
+    
+    ///Glyph of each character on the pages present in the direct lookup.
+    mutable prim::Array<Glyph*> LookupGlyphs;
+    
+    /**Open-addressed hash table of kerning pairs. Each key holds the left
+    character in the upper half and the right character in the lower half.*/
+    mutable prim::Array<prim::uint64> KerningKeys;
+    
+    ///Horizontal adjustment of each kerning pair in the hash table.
+    mutable prim::Array<prim::number> KerningValues;
+    
+    ///Number of bits to shift the hashed pair by to get a table index.
+    mutable prim::count KerningShift;
+    
+    ///Glyph records of a typeface imported on demand that are not yet read.
+    mutable const prim::byte* PendingGlyphs;
+    
+    ///Number of glyph records that are not yet read.
+    prim::count PendingGlyphCount;
+    
+    /**Block of glyphs created together by a mapped import. These are deleted
+    with the block rather than one at a time.*/
+    Glyph* MappedGlyphs;
+    
+    ///Number of glyphs in the mapped block.
+    prim::count MappedGlyphCount;
+    
+#ifdef PRIM_WITH_MEMORY_MAP
+    ///Memory map of a font file whose glyph data is being used in place.
+    prim::MemoryMap* Map;
+#endif
+    
+    ///Header of a mappable typeface. All fields are four-byte little-endian.
+    struct MappedHeader
+    {
+      prim::uint32 MagicNumber;
+      prim::uint32 Version;
+      prim::uint32 Glyphs;
+      prim::uint32 Kernings;
+      prim::uint32 Instructions;
+      prim::uint32 Coordinates;
+      prim::float32 TypographicHeight;
+      prim::float32 TypographicAscender;
+      prim::float32 TypographicDescender;
+      prim::uint32 Reserved;
+    };
+    
+    /**Glyph of a mappable typeface. The instructions and coordinates of the
+    glyph are ranges of the typeface's packed path data.*/
+    struct MappedGlyph
+    {
+      prim::uint32 Character;
+      prim::float32 AdvanceWidth;
+      prim::uint32 FirstKerning;
+      prim::uint32 Kernings;
+      prim::uint32 FirstInstruction;
+      prim::uint32 Instructions;
+      prim::uint32 FirstCoordinate;
+      prim::uint32 Coordinates;
+      prim::float32 Left;
+      prim::float32 Bottom;
+      prim::float32 Right;
+      prim::float32 Top;
+    };
+    
+    ///Kerning pair of a mappable typeface.
+    struct MappedKerning
+    {
+      prim::uint32 FollowingCharacter;
+      prim::float32 HorizontalAdjustment;
+    };
+    
+    ///Identifies a mappable typeface ("BBSF" in little-endian order).
+    static const prim::uint32 MappedMagicNumber = 0x46534242;
+    
+    ///Version of the mappable typeface format.
+    static const prim::uint32 MappedVersion = 1;
+    
+    ///Marks an unused slot in the kerning hash table.
+    static prim::uint64 EmptyKerningKey()
+    {
+      return ~(prim::uint64)0;
+    }
+    
+    ///Returns the slot at which to start searching for a kerning pair.
+    prim::count KerningSlot(prim::uint64 Key) const
+    {
+      return (prim::count)((Key * (prim::uint64)0x9E3779B97F4A7C15ULL) >>
+        KerningShift);
+    }
+    
+    ///Looks up a character with a binary search of the sorted glyph table.
+    Glyph* SearchGlyph(prim::unicode Character) const
+    {
+      prim::count Low = 0;
+      prim::count High = GlyphTable.n() - 1;
+      prim::unicode Key = Character;
+      while(Low <= High)
+      {
+        prim::count Mid = (High - Low) / 2 + Low; //Variant of (Low + High) / 2
+        prim::unicode MidVal = GlyphTable[Mid].c();
+        
+        if(MidVal < Key)
+          Low = Mid + 1;
+        else if(MidVal > Key)
+          High = Mid - 1;
+        else
+          return GlyphTable[Mid].g; //Character found
+      }
+      return 0; //Character not found
+    }
+    
+    ///Builds the direct lookup pages from the sorted glyph table.
+    void BuildDirectLookup() const
+    {
+      const prim::count Pages =
+        (prim::count)DirectLookupLimit / LookupPageSize;
+      LookupPages.n(Pages);
+      for(prim::count i = 0; i < Pages; i++)
+        LookupPages[i] = -1;
+      LookupGlyphs.Clear();
+      
+      for(prim::count i = 0; i < GlyphTable.n(); i++)
+      {
+        prim::unicode c = GlyphTable[i].c();
+        if(c >= DirectLookupLimit)
+          break;
+        
+        prim::count Page = (prim::count)c / LookupPageSize;
+        if(LookupPages[Page] < 0)
+        {
+          LookupPages[Page] = LookupGlyphs.n();
+          for(prim::count j = 0; j < LookupPageSize; j++)
+            LookupGlyphs.Add() = 0;
+        }
+        
+        //Keep the first glyph of each character as the binary search would.
+        Glyph*& g = LookupGlyphs[LookupPages[Page] +
+          (prim::count)c % LookupPageSize];
+        if(!g)
+          g = SearchGlyph(c);
+      }
+    }
+    
+    ///Builds the kerning pair hash table from the glyph kerning arrays.
+    void BuildKerningLookup() const
+    {
+      prim::count Pairs = 0;
+      for(prim::count i = 0; i < GlyphTable.n(); i++)
+        Pairs += GlyphTable[i].g->Kern.n();
+      
+      //Keep the table at most half full.
+      prim::count Size = 16;
+      KerningShift = 64 - 4;
+      while(Size < Pairs * 2)
+        Size *= 2, KerningShift--;
+      KerningKeys.n(Size);
+      KerningValues.n(Size);
+      for(prim::count i = 0; i < Size; i++)
+      {
+        KerningKeys[i] = EmptyKerningKey();
+        KerningValues[i] = 0.0;
+      }
+      
+      for(prim::count i = 0; i < GlyphTable.n(); i++)
+      {
+        //Only use the kerning of the glyph that a lookup would return.
+        Glyph* g = GlyphTable[i].g;
+        if(LookupGlyph(g->Character) != g)
+          continue;
+        
+        for(prim::count j = 0; j < g->Kern.n(); j++)
+        {
+          prim::uint64 Key = ((prim::uint64)g->Character << 32) |
+            (prim::uint64)g->Kern[j].FollowingCharacter;
+          prim::count k = KerningSlot(Key);
+          while(KerningKeys[k] != EmptyKerningKey() && KerningKeys[k] != Key)
+            k = (k + 1) & (Size - 1);
+          
+          //The first pair in the array takes precedence.
+          if(KerningKeys[k] == EmptyKerningKey())
+          {
+            KerningKeys[k] = Key;
+            KerningValues[k] = g->Kern[j].HorizontalAdjustment;
+          }
+        }
+      }
+    }
+    
     public:
     
     /*Font information is stored in inches which is the equivalent of 72 points
@@ -149,16 +364,23 @@ namespace bellebonnesage
     ///Adds a glyph to the typeface.
     Glyph& Add()
     {
+      LoadPendingGlyphs();
       GlyphTableIsSorted = false; //Invalidate the lookup table.
+      ContentGeneration = NextGeneration();
       return *(GlyphTable.Add().g = new Glyph);
     }
     
-    /**Updates glyph lookup table. This is only necessary if the character code
-    of a glyph has been altered after an ith() or LookupGlyph() call.*/
+    /**Updates glyph lookup table. This sorts the glyphs, and builds the
+    direct lookup of characters and the kerning pair table. It is only
+    necessary if the character code or kerning of a glyph has been altered
+    after an ith(), LookupGlyph(), or Kerning() call.*/
     void UpdateLookup() const
     {
+      LoadPendingGlyphs();
       GlyphTable.Sort();
       GlyphTableIsSorted = true;
+      BuildDirectLookup();
+      BuildKerningLookup();
     }
     
     ///Looks up a particular character.
@@ -168,28 +390,22 @@ namespace bellebonnesage
       if(!GlyphTableIsSorted)
         UpdateLookup();
       
-      //Do a binary search for the character.
-      prim::count Low = 0;
-      prim::count High = GlyphTable.n() - 1;
-      prim::unicode Key = Character;
-      while(Low <= High)
+      //Use the direct lookup if the character is in range.
+      if(Character < DirectLookupLimit)
       {
-        prim::count Mid = (High - Low) / 2 + Low; //Variant of (Low + High) / 2
-        prim::unicode MidVal = GlyphTable[Mid].c();
-        
-        if(MidVal < Key)
-          Low = Mid + 1;
-        else if(MidVal > Key)
-          High = Mid - 1;
-        else
-          return GlyphTable[Mid].g; //Character found
+        prim::count Page = LookupPages[(prim::count)Character / LookupPageSize];
+        return Page < 0 ? 0 :
+          LookupGlyphs[Page + (prim::count)Character % LookupPageSize];
       }
-      return 0; //Character not found
+      
+      //Otherwise do a binary search for the character.
+      return SearchGlyph(Character);
     }
     
     ///Returns the number of glyphs in the typeface.
     prim::count n() const
     {
+      LoadPendingGlyphs();
       return GlyphTable.n();
     }
     
@@ -215,18 +431,46 @@ namespace bellebonnesage
     void Clear()
     {
       for(prim::count i = 0; i < GlyphTable.n(); i++)
-        delete GlyphTable[i].g;
+        if(!MappedGlyphs || GlyphTable[i].g < MappedGlyphs ||
+          GlyphTable[i].g >= MappedGlyphs + MappedGlyphCount)
+            delete GlyphTable[i].g;
+      delete [] MappedGlyphs;
+      MappedGlyphs = 0;
+      MappedGlyphCount = 0;
+#ifdef PRIM_WITH_MEMORY_MAP
+      delete Map;
+      Map = 0;
+#endif
       GlyphTable.Clear();
+      PendingGlyphs = 0;
+      PendingGlyphCount = 0;
+      LookupPages.Clear();
+      LookupGlyphs.Clear();
+      KerningKeys.Clear();
+      KerningValues.Clear();
       GlyphBounds = prim::planar::Rectangle();
       TypographicHeight = 0.0;
       TypographicAscender = 0.0;
       TypographicDescender = 0.0;
       GlyphTableIsSorted = false;
+      ContentGeneration = NextGeneration();
+    }
+    
+    /**Returns a number identifying the contents of the typeface. It changes
+    whenever the typeface is cleared, imported or has a glyph added, and is
+    never shared with another typeface, so it can key caches of laid out
+    text that must not outlive the glyphs.*/
+    prim::count Generation() const
+    {
+      return ContentGeneration;
     }
     
     ///Default constructor is a typeface with no glyphs.
-    Typeface()
+    Typeface() : PendingGlyphs(0), MappedGlyphs(0), MappedGlyphCount(0)
     {
+#ifdef PRIM_WITH_MEMORY_MAP
+      Map = 0;
+#endif
       Clear();
     }
     
@@ -245,6 +489,7 @@ namespace bellebonnesage
     {
       if(!GlyphBounds.IsEmpty() || !Recalculate)
         return GlyphBounds;
+      LoadPendingGlyphs();
       
       prim::planar::Rectangle r;
       for(prim::count i = 0; i < GlyphTable.n(); i++)
@@ -261,16 +506,20 @@ namespace bellebonnesage
       return GlyphBounds = r;
     }
     
+    ///Returns the kerning adjustment between a pair of characters.
     prim::number Kerning(prim::unicode Left, prim::unicode Right) const
     {
-      Glyph* g = LookupGlyph(Left);
-
-      if(!g)
-        return 0.0;
-
-      for(prim::count i = 0; i < g->Kern.n(); i++)
-        if(g->Kern[i].FollowingCharacter == Right)
-          return g->Kern[i].HorizontalAdjustment;
+      //Build the lookup tables if necessary.
+      if(!GlyphTableIsSorted)
+        UpdateLookup();
+      
+      //Probe the kerning hash table for the pair.
+      prim::uint64 Key = ((prim::uint64)Left << 32) | (prim::uint64)Right;
+      prim::count Mask = KerningKeys.n() - 1;
+      for(prim::count k = KerningSlot(Key); KerningKeys[k] !=
+        EmptyKerningKey(); k = (k + 1) & Mask)
+          if(KerningKeys[k] == Key)
+            return KerningValues[k];
 
       return 0.0;
     }
@@ -498,6 +747,9 @@ namespace bellebonnesage
             g->Kern.Add() = Kern;
       }
       
+      //Rebuild the kerning lookup now that the kerning pairs are known.
+      UpdateLookup();
+      
       //Retrieve font information from <bellebonnesage::font ...>
       prim::String::Span FontSpan(-1, -1);
       
@@ -561,6 +813,56 @@ namespace bellebonnesage
       return Value;
     }
     
+    ///Reads the glyphs of a typeface imported on demand if not yet read.
+    void LoadPendingGlyphs() const
+    {
+      if(!PendingGlyphs)
+        return;
+      const prim::byte* b = PendingGlyphs;
+      PendingGlyphs = 0;
+      GlyphTable.n(PendingGlyphCount);
+      for(prim::count i = 0; i < GlyphTable.n(); i++)
+      {
+        Glyph* g = GlyphTable[i].g = new Glyph;
+        
+        g->Character = ReadFromArray<prim::int32>(b);
+        g->AdvanceWidth = ReadFromArray<prim::float32>(b);
+        g->Kern.n(ReadFromArray<prim::int32>(b));
+        for(prim::count j = 0; j < g->Kern.n(); j++)
+        {
+          g->Kern[j].FollowingCharacter = ReadFromArray<prim::int32>(b);
+          g->Kern[j].HorizontalAdjustment = ReadFromArray<prim::float32>(b);
+        }
+        prim::count Instructions = ReadFromArray<prim::int32>(b);
+        for(prim::count j = 0; j < Instructions; j++)
+        {
+          prim::byte Type = ReadFromArray<prim::byte>(b);
+          if(Type == Instruction::ClosePath)
+            g->Add(Instruction());
+          else
+          {
+            prim::planar::Vector e;
+            e.x = ReadFromArray<prim::float32>(b);
+            e.y = ReadFromArray<prim::float32>(b);
+            if(Type == Instruction::MoveTo)
+              g->Add(Instruction(e, true));
+            else if(Type == Instruction::LineTo)
+              g->Add(Instruction(e));
+            else
+            {
+              prim::planar::Vector c1, c2;
+              c1.x = ReadFromArray<prim::float32>(b);
+              c1.y = ReadFromArray<prim::float32>(b);
+              c2.x = ReadFromArray<prim::float32>(b);
+              c2.y = ReadFromArray<prim::float32>(b);
+              g->Add(Instruction(c1, c2, e));
+            }
+          }
+        }
+      }
+    }
+    
+    
     public:
     
     /**Exports the typeface or a portion of the typeface to an array. If p and
@@ -569,6 +871,8 @@ namespace bellebonnesage
     void ExportToArray(prim::Array<prim::byte>& a, prim::count p = 0,
       prim::count q = -1)
     {
+      LoadPendingGlyphs();
+      
       //Process the range arguments.
       if(q < 0) q = GlyphTable.n() - 1;
       if(p < 0) p = 0;
@@ -616,7 +920,22 @@ namespace bellebonnesage
       }
     }
     
+    ///Imports a typeface from an array created by ExportToArray().
     void ImportFromArray(const prim::byte* Data)
+    {
+      ImportFromArrayOnDemand(Data);
+      LoadPendingGlyphs();
+      
+      //Build the glyph and kerning lookups.
+      UpdateLookup();
+    }
+    
+    /**Imports the typographic information of a typeface from an array created
+    by ExportToArray() and defers reading the glyphs until they are first used.
+    The data must stay valid until then. A typeface loaded on demand should be
+    used by one thread until its glyphs are loaded, for example by calling
+    UpdateLookup().*/
+    void ImportFromArrayOnDemand(const prim::byte* Data)
     {
       Clear();
       if(!Data)
@@ -625,51 +944,237 @@ namespace bellebonnesage
       prim::count MagicNumber = ReadFromArray<prim::int32>(b);
       if(MagicNumber != 49285378)
         return;
-      GlyphTable.n(ReadFromArray<prim::int32>(b));
+      PendingGlyphCount = ReadFromArray<prim::int32>(b);
       TypographicHeight = ReadFromArray<prim::float32>(b);
       TypographicAscender = ReadFromArray<prim::float32>(b);
       TypographicDescender = ReadFromArray<prim::float32>(b);
+      PendingGlyphs = b;
+    }
+    
+    /**Exports the typeface in a form that can be memory-mapped and used in
+    place by ImportFromMappedArray(). The glyph paths are stored packed as
+    they are in memory and every section is four-byte aligned.*/
+    void ExportToMappableArray(prim::Array<prim::byte>& a) const
+    {
+      //Sort the lookup table if necessary.
+      if(!GlyphTableIsSorted)
+        UpdateLookup();
+      
+      prim::count Kernings = 0, Instructions = 0, Coordinates = 0;
       for(prim::count i = 0; i < GlyphTable.n(); i++)
       {
-        Glyph* g = GlyphTable[i].g = new Glyph;
-        
-        g->Character = ReadFromArray<prim::int32>(b);
-        g->AdvanceWidth = ReadFromArray<prim::float32>(b);
-        g->Kern.n(ReadFromArray<prim::int32>(b));
+        Glyph* g = GlyphTable[i].g;
+        Kernings += g->Kern.n();
+        Instructions += g->n();
+        Coordinates += g->PackedCoordinateCount();
+      }
+      
+      AddToArray(a, (prim::uint32)MappedMagicNumber);
+      AddToArray(a, (prim::uint32)MappedVersion);
+      AddToArray(a, (prim::uint32)GlyphTable.n());
+      AddToArray(a, (prim::uint32)Kernings);
+      AddToArray(a, (prim::uint32)Instructions);
+      AddToArray(a, (prim::uint32)Coordinates);
+      AddToArray(a, (prim::float32)TypographicHeight);
+      AddToArray(a, (prim::float32)TypographicAscender);
+      AddToArray(a, (prim::float32)TypographicDescender);
+      AddToArray(a, (prim::uint32)0);
+      
+      //Write the glyphs.
+      Kernings = Instructions = Coordinates = 0;
+      for(prim::count i = 0; i < GlyphTable.n(); i++)
+      {
+        Glyph* g = GlyphTable[i].g;
+        prim::planar::Rectangle r = g->Bounds();
+        if(r.IsEmpty())
+          r = prim::planar::Rectangle(0.0, 0.0, 0.0, 0.0);
+        AddToArray(a, (prim::uint32)g->Character);
+        AddToArray(a, (prim::float32)g->AdvanceWidth);
+        AddToArray(a, (prim::uint32)Kernings);
+        AddToArray(a, (prim::uint32)g->Kern.n());
+        AddToArray(a, (prim::uint32)Instructions);
+        AddToArray(a, (prim::uint32)g->n());
+        AddToArray(a, (prim::uint32)Coordinates);
+        AddToArray(a, (prim::uint32)g->PackedCoordinateCount());
+        AddToArray(a, (prim::float32)r.Left());
+        AddToArray(a, (prim::float32)r.Bottom());
+        AddToArray(a, (prim::float32)r.Right());
+        AddToArray(a, (prim::float32)r.Top());
+        Kernings += g->Kern.n();
+        Instructions += g->n();
+        Coordinates += g->PackedCoordinateCount();
+      }
+      
+      //Write the kerning pairs.
+      for(prim::count i = 0; i < GlyphTable.n(); i++)
+      {
+        Glyph* g = GlyphTable[i].g;
         for(prim::count j = 0; j < g->Kern.n(); j++)
         {
-          g->Kern[j].FollowingCharacter = ReadFromArray<prim::int32>(b);
-          g->Kern[j].HorizontalAdjustment = ReadFromArray<prim::float32>(b);
+          AddToArray(a, (prim::uint32)g->Kern[j].FollowingCharacter);
+          AddToArray(a, (prim::float32)g->Kern[j].HorizontalAdjustment);
         }
-        prim::count Instructions = ReadFromArray<prim::int32>(b);
-        for(prim::count j = 0; j < Instructions; j++)
+      }
+      
+      //Write the offsets, coordinates, and verbs of the paths.
+      for(prim::count i = 0; i < GlyphTable.n(); i++)
+      {
+        Glyph* g = GlyphTable[i].g;
+        for(prim::count j = 0; j < g->n(); j++)
+          AddToArray(a, (prim::uint32)g->PackedOffsets()[j]);
+      }
+      for(prim::count i = 0; i < GlyphTable.n(); i++)
+      {
+        Glyph* g = GlyphTable[i].g;
+        for(prim::count j = 0; j < g->PackedCoordinateCount(); j++)
+          AddToArray(a, (prim::float32)g->PackedCoordinates()[j]);
+      }
+      for(prim::count i = 0; i < GlyphTable.n(); i++)
+      {
+        Glyph* g = GlyphTable[i].g;
+        for(prim::count j = 0; j < g->n(); j++)
+          AddToArray(a, (prim::byte)g->PackedVerbs()[j]);
+      }
+      
+      //Pad the end to a multiple of four bytes.
+      while(a.n() % 4)
+        AddToArray(a, (prim::byte)0);
+    }
+    
+    /**Imports a typeface exported by ExportToMappableArray() and uses its path
+    data in place without copying it. The data must be four-byte aligned and
+    must stay valid until the typeface is cleared. Copies of the glyph paths
+    also refer to the data, so they must not outlive it either. Returns false
+    if the data is not a mappable typeface, in which case the typeface is left
+    empty. Only little-endian machines can use the data in place.*/
+    bool ImportFromMappedArray(const prim::byte* Data, prim::count Length)
+    {
+      Clear();
+      if(!Data || Length < (prim::count)sizeof(MappedHeader) ||
+        ((prim::uintptr)Data % 4) || !prim::Endian::IsLittleEndian())
+          return false;
+      
+      //Check the header and the length of the sections.
+      const MappedHeader& h = *(const MappedHeader*)Data;
+      if(h.MagicNumber != MappedMagicNumber || h.Version != MappedVersion)
+        return false;
+      prim::uint64 Required = (prim::uint64)sizeof(MappedHeader) +
+        (prim::uint64)h.Glyphs * sizeof(MappedGlyph) +
+        (prim::uint64)h.Kernings * sizeof(MappedKerning) +
+        (prim::uint64)h.Instructions * sizeof(prim::uint32) +
+        (prim::uint64)h.Coordinates * sizeof(prim::float32) +
+        (prim::uint64)h.Instructions;
+      if(Required > (prim::uint64)Length)
+        return false;
+      
+      //Locate the sections.
+      const MappedGlyph* Glyphs = (const MappedGlyph*)(Data +
+        sizeof(MappedHeader));
+      const MappedKerning* Kernings =
+        (const MappedKerning*)(Glyphs + h.Glyphs);
+      const prim::uint32* Offsets = (const prim::uint32*)(Kernings +
+        h.Kernings);
+      const prim::float32* Coordinates =
+        (const prim::float32*)(Offsets + h.Instructions);
+      const prim::byte* Verbs = (const prim::byte*)(Coordinates +
+        h.Coordinates);
+      
+      //Make sure that each glyph refers to data inside the sections.
+      for(prim::count i = 0; i < (prim::count)h.Glyphs; i++)
+      {
+        const MappedGlyph& m = Glyphs[i];
+        if((prim::uint64)m.FirstKerning + m.Kernings > h.Kernings ||
+          (prim::uint64)m.FirstInstruction + m.Instructions > h.Instructions ||
+          (prim::uint64)m.FirstCoordinate + m.Coordinates > h.Coordinates)
+            return false;
+        
+        /*Make sure that each instruction is known and that the coordinates it
+        reads lie inside the glyph's coordinates.*/
+        for(prim::count j = 0; j < (prim::count)m.Instructions; j++)
         {
-          prim::byte Type = ReadFromArray<prim::byte>(b);
-          if(Type == Instruction::ClosePath)
-            g->Add(Instruction());
-          else
+          prim::uint64 Needed = 0;
+          switch(Verbs[m.FirstInstruction + j])
           {
-            prim::planar::Vector e;
-            e.x = ReadFromArray<prim::float32>(b);
-            e.y = ReadFromArray<prim::float32>(b);
-            if(Type == Instruction::MoveTo)
-              g->Add(Instruction(e, true));
-            else if(Type == Instruction::LineTo)
-              g->Add(Instruction(e));
-            else
-            {
-              prim::planar::Vector c1, c2;
-              c1.x = ReadFromArray<prim::float32>(b);
-              c1.y = ReadFromArray<prim::float32>(b);
-              c2.x = ReadFromArray<prim::float32>(b);
-              c2.y = ReadFromArray<prim::float32>(b);
-              g->Add(Instruction(c1, c2, e));
-            }
+            case 1: case 2: Needed = 2; break; //Move-to and line-to
+            case 3: Needed = 6; break; //Cubic-to
+            case 4: break; //Close-path
+            default: return false;
           }
+          if((prim::uint64)Offsets[m.FirstInstruction + j] + Needed >
+            m.Coordinates)
+              return false;
         }
       }
+      
+      //Create the glyphs together and point their paths at the data.
+      MappedGlyphCount = (prim::count)h.Glyphs;
+      MappedGlyphs = new Glyph[MappedGlyphCount ? MappedGlyphCount : 1];
+      GlyphTable.n(MappedGlyphCount);
+      for(prim::count i = 0; i < MappedGlyphCount; i++)
+      {
+        const MappedGlyph& m = Glyphs[i];
+        Glyph* g = GlyphTable[i].g = &MappedGlyphs[i];
+        g->Character = (prim::unicode)m.Character;
+        g->AdvanceWidth = (prim::number)m.AdvanceWidth;
+        g->Kern.n((prim::count)m.Kernings);
+        for(prim::count j = 0; j < g->Kern.n(); j++)
+        {
+          const MappedKerning& k = Kernings[m.FirstKerning + j];
+          g->Kern[j].FollowingCharacter = k.FollowingCharacter;
+          g->Kern[j].HorizontalAdjustment = k.HorizontalAdjustment;
+        }
+        
+        prim::planar::Rectangle r;
+        if(m.Instructions)
+          r = prim::planar::Rectangle(m.Left, m.Bottom, m.Right, m.Top);
+        g->Refer(Verbs + m.FirstInstruction, Offsets + m.FirstInstruction,
+          (prim::count)m.Instructions, Coordinates + m.FirstCoordinate,
+          (prim::count)m.Coordinates, r);
+      }
+      TypographicHeight = h.TypographicHeight;
+      TypographicAscender = h.TypographicAscender;
+      TypographicDescender = h.TypographicDescender;
+      
+      //Build the glyph and kerning lookups.
+      UpdateLookup();
+      return true;
     }
-  
+    
+#ifdef PRIM_WITH_MEMORY_MAP
+    /**Memory-maps a font file and imports it. A mappable typeface is used in
+    place, so processes loading the same file share one copy of the glyph data
+    and no per-instruction work is done. Otherwise the file is imported as an
+    original bellefont whose glyphs are read on demand from the map. Returns
+    whether the typeface was imported.*/
+    bool ImportFromMappedFile(const prim::ascii* Filename)
+    {
+      Clear();
+      prim::MemoryMap* m = new prim::MemoryMap;
+      if(!m->Open(Filename))
+      {
+        delete m;
+        return false;
+      }
+      
+      const prim::byte* Data = (const prim::byte*)m->a();
+      if(ImportFromMappedArray(Data, m->n()))
+      {
+        Map = m;
+        return true;
+      }
+      
+      //Not a mappable typeface, so read it as an original bellefont.
+      ImportFromArrayOnDemand(Data);
+      if(!PendingGlyphs)
+      {
+        delete m;
+        return false;
+      }
+      Map = m;
+      return true;
+    }
+#endif
+
     ///Attempts to load a typeface from a data block using the FreeType library.
     prim::String ImportFromFontData(const prim::byte* ByteArray,
       prim::count LengthInBytes);
@@ -939,6 +1444,14 @@ namespace bellebonnesage
       return TypefaceTable.Add() = new Typeface;
     }
     
+    /**Adds an existing typeface to the font, which takes ownership of it. This
+    lets a typeface be imported first and added only if the import works.*/
+    Typeface* Add(Style StyleDescriptor, Typeface* TypefaceToAdd)
+    {
+      StyleTable.Add() = StyleDescriptor;
+      return TypefaceTable.Add() = TypefaceToAdd;
+    }
+    
     ///Adds the next highest priority typeface from an SVG string.
     void AddTypefaceFromSVGString(const prim::String& s, Style StyleDescriptor)
     {
@@ -42,6 +42,22 @@ namespace bellebonnesage { namespace graph
       NUM_DISPLAY_TYPES
     };
 
+    /**A set of string indexes stored as a bitmask, where bit i is set if
+    string i is in the set. Only the first 32 strings can be represented.*/
+    typedef prim::uint32 StringSet;
+
+    ///A string and fret assignment for a single note
+    struct Fingering
+    {
+      ///The string index, or negative if the note could not be placed
+      prim::count StringIndex;
+
+      ///The fret on the string, or negative if the note could not be placed
+      prim::count Fret;
+
+      Fingering() : StringIndex (-1), Fret (-1) {}
+    };
+
     ///Represents a string on an instrument
     struct InstrumentString
     {
@@ -279,6 +295,75 @@ namespace bellebonnesage { namespace graph
       return AvailableStrings;
     }
 
+    ///Returns true if the string index is in the string set
+    static bool IsStringInSet (StringSet Set, prim::count StringIndex)
+    {
+      return StringIndex >= 0 && StringIndex < 32 && 
+        (Set & ((StringSet)1 << StringIndex)) != 0;
+    }
+
+    ///Adds the string index to the string set
+    static void AddStringToSet (StringSet& Set, prim::count StringIndex)
+    {
+      if (StringIndex >= 0 && StringIndex < 32)
+        Set |= ((StringSet)1 << StringIndex);
+    }
+
+    /**Assigns a string and fret to every note of a sequence of chords given
+    as MIDI note numbers. The notes of all the chords are given one after the 
+    other in MidiNotes, and ChordSizes holds the number of notes in each 
+    chord. Each note takes the highest string that is not already used in 
+    its chord and on which the note exists. One fingering is returned per 
+    note in the same order as MidiNotes*/
+    void GetFingeringsForChords (const prim::Array<prim::count>& MidiNotes,
+      const prim::Array<prim::count>& ChordSizes, 
+      prim::Array<Fingering>& Fingerings) const
+    {
+      Fingerings.n (MidiNotes.n());
+
+      //Look up the range of each string once for the whole sequence.
+      prim::count NumStrings = (Strings.n() < 32 ? Strings.n() : 32);
+      prim::count Lowest[32], Highest[32];
+      for (prim::count i = 0; i < NumStrings; ++i)
+      {
+        Lowest[i] = mica::index (mica::MIDIValues, Strings.ith (i).MidiNote,
+          mica::MIDIValue0);
+        Highest[i] = Lowest[i] + Strings.ith (i).Semitones;
+      }
+
+      prim::count Note = 0;
+      for (prim::count i = 0; i < ChordSizes.n(); ++i)
+      {
+        StringSet UsedStrings = 0;
+        prim::count End = Note + ChordSizes[i];
+        if (End > MidiNotes.n()) 
+          End = MidiNotes.n();
+
+        for (; Note < End; ++Note)
+        {
+          prim::count Midi = MidiNotes[Note];
+          Fingering& f = Fingerings[Note];
+          f = Fingering();
+
+          for (prim::count j = 0; j < NumStrings; ++j)
+          {
+            if (!IsStringInSet (UsedStrings, j) && 
+              Midi >= Lowest[j] && Midi <= Highest[j])
+            {
+              f.StringIndex = j;
+              f.Fret = Midi - Lowest[j];
+              AddStringToSet (UsedStrings, j);
+              break;
+            }
+          }
+        }
+      }
+
+      //Any notes beyond the given chord sizes are left unplaced.
+      for (; Note < MidiNotes.n(); ++Note)
+        Fingerings[Note] = Fingering();
+    }
+
     ///Returns true if the number of strings is available for the instrument
     static bool IsStringNumberAvailableForInstrument (
       StringedInstrument::InstrumentType Type, 
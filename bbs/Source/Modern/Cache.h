@@ -69,15 +69,59 @@ namespace bellebonnesage { namespace modern
       AccidentalSharp,
       AccidentalDoubleSharp,
       RhythmicDot,
+      TabStem,
+      TabStemCap,
+      TabFlagsOne,
+      TabFlagsTwo,
+      TabFlagsThree,
+      TabFlagsFour,
+      TabFlagsFive,
       CachedStamps
     };
     
-    ///Caches all object paths.
+    private:
+    
+    ///House style that the paths were created with.
+    House Style;
+    
+    ///Typeface that the paths were created with.
+    const Typeface* StyleTypeface;
+    
+    public:
+    
+    ///Creates an empty cache.
+    Cache() : StyleTypeface(0) {}
+    
+    /**Returns whether the paths have been created with the given typeface and
+    a house style with the same constants as the given one.*/
+    bool IsCreatedWith(const House& h, const Typeface& t) const
+    {
+      return n() == CachedStamps && StyleTypeface == &t &&
+        Style.NoteheadAngle == h.NoteheadAngle &&
+        Style.NoteheadWidth == h.NoteheadWidth &&
+        Style.NoteheadWidthPrecise == h.NoteheadWidthPrecise &&
+        Style.DefaultStemHeight == h.DefaultStemHeight &&
+        Style.LedgerLineExtraInner == h.LedgerLineExtraInner &&
+        Style.LedgerLineExtraOuter == h.LedgerLineExtraOuter &&
+        Style.StaffLineThickness == h.StaffLineThickness &&
+        Style.StemWidth == h.StemWidth &&
+        Style.RhythmicDotSize == h.RhythmicDotSize;
+    }
+    
+    /**Caches all object paths. If the paths have already been created with
+    the same house style constants and typeface then nothing is done.*/
     void Create(const House& h, const Typeface& t)
     {
       using namespace prim;
       using namespace prim::planar;
       
+      //Reuse the paths if nothing they depend on has changed.
+      if(IsCreatedWith(h, t))
+        return;
+      ClearAndDeleteAll();
+      Style = h;
+      StyleTypeface = &t;
+      
       //Create paths to store the objects.
       Array<Path*>& a = *this;      
       a.n(CachedStamps);
@@ -172,6 +216,37 @@ namespace bellebonnesage { namespace modern
       
       //RhythmicDot
       Shapes::AddCircle(*a[RhythmicDot], Vector(), h.RhythmicDotSize);
+      
+      /*TabStem is a stem of unit length with square ends extending upwards
+      from the origin. Tab stem lengths depend on the lowest fret number, so
+      the stem is stretched vertically to the required length when placed.
+      Stretching would distort round caps, so these are kept separately in
+      TabStemCap and placed unscaled at each end of the stem.*/
+      Shapes::AddLine(*a[TabStem], Vector(0., 1.), Vector(), h.StemWidth,
+        true, false, false);
+      
+      //TabStemCap
+      Shapes::AddCircle(*a[TabStemCap], Vector(), h.StemWidth);
+      
+      /*
+      TabFlagsOne
+      TabFlagsTwo
+      TabFlagsThree
+      TabFlagsFour
+      TabFlagsFive
+      */
+      {
+        /*Tab stems always point downwards, so the flags are flipped and are
+        stacked one space apart going up from the end of the stem.*/
+        if(const Path* Flag = t.LookupGlyph(87))
+        {
+          for(count i = 0; i <= TabFlagsFive - TabFlagsOne; i++)
+            for(count j = 0; j <= i; j++)
+              a[TabFlagsOne + i]->Append(*Flag,
+                Affine::Translate(Vector(0., (number)j)) * Affine::Scale(4.0) *
+                Affine::Scale(Vector(1.0, -1.0)));
+        }
+      }
     }    
     ///Destructor deletes the cached paths.
     ~Cache() {ClearAndDeleteAll();}
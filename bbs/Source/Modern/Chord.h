@@ -213,6 +213,7 @@ namespace bellebonnesage { namespace modern
         Utility::GetLineSpacePosition(
         StaffNotes.a().LineSpace, StaffLines, h))) * Affine::Scale(4.0);
       s.z().n = StaffNotes.a().OriginalNode;
+      s.z().Body = true;
       
       //Update the bounding box.
       if(s.z().p2)
@@ -323,6 +324,7 @@ namespace bellebonnesage { namespace modern
           b.b += NoteheadPosition;
           
           s.z().n = StaffNotes[i].OriginalNode;
+          s.z().Body = true;
         }
         
         //If the annotation property is set, display the text next to the note.
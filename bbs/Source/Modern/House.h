@@ -114,6 +114,15 @@ namespace bellebonnesage { namespace modern
     ///Proportional size of a non initial clef.
     prim::number NonInitialClefSize;
     
+    ///Height of the bands of the skylines used to space instants
+    prim::number SkylineBandHeight;
+    
+    ///Horizontal padding kept between instants on a part
+    prim::number SkylinePadding;
+    
+    ///Number of neighbouring skyline bands that also keep the padding
+    prim::count SkylineVerticalBands;
+    
     ///Default set of reasonable style choices
     void Default()
     {
@@ -141,6 +150,9 @@ namespace bellebonnesage { namespace modern
       RhythmicDotNoteheadDistance = 1.1;
       RhythmicDotSpacing = 1.0;
       NonInitialClefSize = 0.8;
+      SkylineBandHeight = 0.5;
+      SkylinePadding = 0.25;
+      SkylineVerticalBands = 1;
     }
 
     ///Overload and add custom constant definitions.
@@ -61,16 +61,38 @@ namespace bellebonnesage { namespace modern
     
     ///Engraves the island.
     void Engrave(graph::MusicNode* n, Stamp& s, bool isOnExtraStaff = false)
+    {
+      prim::Array<Stamp*> ExtraStamps;
+      if(isOnExtraStaff)
+      {
+        ExtraStamps.Add() = &s;
+        Engrave(n, 0, ExtraStamps);
+      }
+      else
+        Engrave(n, &s, ExtraStamps);
+    }
+    
+    /**Engraves the island onto its main stamp and its extra staff stamps in a
+    single pass. The tokens, stem state and rest displacement are determined
+    once and shared by each stamp. The main stamp may be null if only the extra
+    staves need typesetting.*/
+    void Engrave(graph::MusicNode* n, Stamp* s,
+      const prim::Array<Stamp*>& ExtraStamps)
     {
       //Get all the tokens belonging to the island.
       prim::Node::Array<graph::Token> Tokens(n, graph::ID(mica::TokenLink));
       prim::Array<graph::Token*> TokenArray;
       n->FindAll(TokenArray, graph::ID(mica::TokenLink));
-      UpdateStemState(TokenArray);
+
+      /*Tab-only parts have no stems or rest positions of their own, so the
+      stem state and rest displacement are only needed for standard notation.*/
+      bool TabOnly = d.s.IsTabStaff();
+      if(!TabOnly)
+        UpdateStemState(TokenArray);
 
       //Displace rests.
       bellebonnesage::graph::ChordToken* ShiftLeft = 0;
-      if(d.s.Current.n() == 2)
+      if(!TabOnly && d.s.Current.n() == 2)
       {
         Chord::StateInfo* Bottom, *Top;
         if(d.s.Current[0].d == Chord::StateInfo::Down)
@@ -123,19 +145,30 @@ namespace bellebonnesage { namespace modern
         }
       }
       
-      //Engrave each token.
+      //Engrave each token onto each of the stamps.
       for(prim::count i = 0; i < Tokens.n(); i++)
       {
-        prim::count Start = s.Graphics.n();
-        EngraveToken(Tokens[i], s, isOnExtraStaff);
-        
-        if(Tokens[i] == ShiftLeft)
-          for(prim::count j = Start; j < s.Graphics.n(); j++)
-            s.Graphics[j]->a = (Affine::Translate(
-              prim::planar::Vector(-1.4, 0.0)) * s.Graphics[j]->a);
+        if(s)
+          EngraveToken(Tokens[i], *s, false, Tokens[i] == ShiftLeft);
+        for(prim::count j = 0; j < ExtraStamps.n(); j++)
+          EngraveToken(Tokens[i], *ExtraStamps[j], true,
+            Tokens[i] == ShiftLeft);
       }
     }
     
+    ///Engraves the token, optionally shifting it left to avoid a collision.
+    void EngraveToken(graph::Token* Token, Stamp& s, bool isOnExtraStaff,
+      bool Shift)
+    {
+      prim::count Start = s.Graphics.n();
+      EngraveToken(Token, s, isOnExtraStaff);
+      
+      if(Shift)
+        for(prim::count j = Start; j < s.Graphics.n(); j++)
+          s.Graphics[j]->a = (Affine::Translate(
+            prim::planar::Vector(-1.4, 0.0)) * s.Graphics[j]->a);
+    }
+    
     ///Updates the current stem state.
     void UpdateStemState(prim::Array<graph::Token*>& Tokens)
     {
@@ -297,8 +330,14 @@ namespace bellebonnesage { namespace modern
       else if(graph::KeySignatureToken* kt =
         dynamic_cast<graph::KeySignatureToken*>(Token))
       {
-        mica::UUID k = kt->GetKeySignature();
         d.s.ActiveKey = kt->GetKey();
+
+        /*Tab staves resolve pitches from the clef and key alone and do not
+        track accidentals.*/
+        if(d.s.IsTabStaff())
+          return;
+
+        mica::UUID k = kt->GetKeySignature();
         d.s.SetKeySignature(k);
         d.s.ResetActiveAccidentalsToKeySignature();
         KeySignature::Engrave(d, s, kt, isOnExtraStaff);
@@ -311,7 +350,8 @@ namespace bellebonnesage { namespace modern
         dynamic_cast<graph::BarlineToken*>(Token))
       {
         Barline::Engrave(d, s, bt, isOnExtraStaff);
-        d.s.ResetActiveAccidentalsToKeySignature();
+        if(!d.s.IsTabStaff())
+          d.s.ResetActiveAccidentalsToKeySignature();
       }
       else
       {
@@ -118,14 +118,15 @@ namespace bellebonnesage { namespace modern
           if(n->Find(ct, graph::ID(mica::TokenLink)))
             n->Typesetting = new Stamp(n);
 
+          /*Gather the stamps needing typesetting so that the main staff and
+          any extra staves (such as the tab staff of a standard and tab part)
+          are engraved together in a single pass over the island.*/
+          Stamp* MainStamp = 0;
+          prim::Array<Stamp*> ExtraStamps;
           if(prim::Pointer<Stamp> s = n->Typesetting)
           {
             if(s->NeedsTypesetting)
-            {
-              Engraver.Engrave(n, *s);
-              d.s.AdvanceAccidentalState();
-              s->NeedsTypesetting = false;
-            }
+              MainStamp = &*s;
           }
           else
             prim::c >> "Warning: Stamp not created for MusicNode.";
@@ -135,11 +136,23 @@ namespace bellebonnesage { namespace modern
             if (prim::Pointer<Stamp> s = n->ExtraTypesetting[i])
             {
               if(s->NeedsTypesetting)
-              {
-                Engraver.Engrave(n, *s, true);
-                d.s.AdvanceAccidentalState();
-                s->NeedsTypesetting = false;
-              }
+                ExtraStamps.Add() = &*s;
+            }
+          }
+
+          if(MainStamp || ExtraStamps.n())
+          {
+            Engraver.Engrave(n, MainStamp, ExtraStamps);
+            d.s.AdvanceAccidentalState();
+            if(MainStamp)
+            {
+              MainStamp->NeedsTypesetting = false;
+              MainStamp->InvalidateBounds();
+            }
+            for(prim::count i = 0; i < ExtraStamps.n(); i++)
+            {
+              ExtraStamps[i]->NeedsTypesetting = false;
+              ExtraStamps[i]->InvalidateBounds();
             }
           }
 
@@ -307,22 +320,53 @@ namespace bellebonnesage { namespace modern
     //--------------------------------------------------------------------------
 
     /**Calculates a new left-justified leading edge from an edge and an instant.
-    The new leading edge is returned as an array, the new instant origin is
-    updated, and*/
+    Each part keeps a skyline of the stamps placed so far, and the instant is
+    moved left until one of its stamps comes within the padding of that
+    skyline, so attachments such as accidentals, dots and flags may tuck under
+    the overhangs of earlier stamps. The body of each stamp (its noteheads,
+    rest or tab numbers) is kept clear of the bodies already on the part, so
+    the notes of a part stay in order. The instant never starts before the
+    previous instant origin (passed in through the instant origin) plus the
+    padding, or before the start of the system. The coarse leading edge of
+    each part is also updated, the new instant origin is returned through the
+    reference, and the furthest-right point on the leading edge is returned.*/
     static prim::number CalculateNextLeadingEdge(const StampInstant& Instant,
-      prim::Array<prim::number>& LeadingEdge, prim::number& InstantOrigin)
-    {      
-      ///Array to store new leading edge.
-      prim::Array<prim::number> NewLeadingEdge;
+      const House& h, prim::Array<prim::number>& LeadingEdge,
+      prim::Array<Skyline>& LeadingProfile,
+      prim::Array<prim::number>& LeadingBody, prim::number& InstantOrigin)
+    {
+      const prim::number Padding = h.SkylinePadding;
       
       //Make sure the leading edge is correctly sized.
-      if(LeadingEdge.n() != Instant.n())
+      if(LeadingEdge.n() != Instant.n() || LeadingProfile.n() != Instant.n() ||
+        LeadingBody.n() != Instant.n())
       {
         prim::c >> "Error: Leading edge length (" << LeadingEdge.n() << ") "
           << "does not match number of parts (" << Instant.n() << ").";
         return 0.0;
       }
       
+      //Calculate the profile of each stamp in the instant.
+      prim::Array<Skyline> Profiles;
+      Profiles.n(Instant.n());
+      for(prim::count i = 0; i < Instant.n(); i++)
+      {
+        Profiles[i] = Skyline(h.SkylineBandHeight);
+        if(Instant[i] && !Instant[i]->Bounds().IsEmpty())
+          Instant[i]->AddToSkyline(Profiles[i]);
+      }
+      
+      //Only advance past the previous origin if something has been placed.
+      prim::number PreviousOrigin = InstantOrigin;
+      for(prim::count i = 0; i < LeadingProfile.n(); i++)
+      {
+        if(!LeadingProfile[i].IsEmpty())
+        {
+          PreviousOrigin += Padding;
+          break;
+        }
+      }
+      
       //Calculate the new origin.
       bool SetOrigin = false;
       for(prim::count i = 0; i < LeadingEdge.n(); i++)
@@ -331,10 +375,19 @@ namespace bellebonnesage { namespace modern
         if(!Instant[i] || Instant[i]->Bounds().IsEmpty())
           continue;
         
-        /*Note that in the future it is possible that collision detection could
-        be used here from Source/Optics.h instead of using coarse bounding
-        boxes.*/
-        prim::number LeastOrigin = LeadingEdge[i] - Instant[i]->Bounds().Left();
+        //Keep the stamp after the previous instant and the system start.
+        prim::number LeastOrigin = prim::Max(PreviousOrigin,
+          -Instant[i]->Bounds().Left());
+        
+        //Keep the stamp clear of the stamps already placed on the part.
+        LeastOrigin = prim::Max(LeastOrigin, Skyline::Separation(
+          LeadingProfile[i], Profiles[i], Padding, h.SkylineVerticalBands));
+        
+        //Keep the body of the stamp after the bodies placed on the part.
+        if(!LeadingProfile[i].IsEmpty())
+          LeastOrigin = prim::Max(LeastOrigin, LeadingBody[i] + Padding -
+            Instant[i]->BodyBounds().Left());
+        
         if(!SetOrigin)
         {
           InstantOrigin = LeastOrigin;
@@ -345,21 +398,23 @@ namespace bellebonnesage { namespace modern
       }
       
       //Calculate the new leading edge.
-      NewLeadingEdge = LeadingEdge;
       prim::number FurthestRight = 0.0;
       for(prim::count i = 0; i < LeadingEdge.n(); i++)
       {
         //If the stamp exists on this part then increase the leading edge.
         if(Instant[i] && !Instant[i]->Bounds().IsEmpty())
-          NewLeadingEdge[i] = InstantOrigin + Instant[i]->Bounds().Right();
+        {
+          LeadingEdge[i] = prim::Max(LeadingEdge[i],
+            InstantOrigin + Instant[i]->Bounds().Right());
+          LeadingProfile[i].Merge(Profiles[i], InstantOrigin);
+          LeadingBody[i] = prim::Max(LeadingBody[i],
+            InstantOrigin + Instant[i]->BodyBounds().Right());
+        }
         
         //Keep track of the furthest-right point.
-        FurthestRight = prim::Max(FurthestRight, NewLeadingEdge[i]);
+        FurthestRight = prim::Max(FurthestRight, LeadingEdge[i]);
       }
       
-      //Copy the new leading edge back to the caller array.
-      LeadingEdge = NewLeadingEdge;
-      
       //Return the furthest right point on the leading edge.
       return FurthestRight;
     }
@@ -454,6 +509,9 @@ namespace bellebonnesage { namespace modern
         System& Current = Systems.Add();
         Current.LeadingEdge.n(PartCount + NumExtraStaves);
         Current.LeadingEdge.Zero();
+        Current.LeadingProfile.n(PartCount + NumExtraStaves);
+        Current.LeadingBody.n(PartCount + NumExtraStaves);
+        Current.LeadingBody.Zero();
         Current.Staves = Staves;
         
         /*Deep copy all the repeated elements to the front of the system. The
@@ -466,7 +524,8 @@ namespace bellebonnesage { namespace modern
           Current.Instants.Add().DeepCopyFrom(Repeated[i]);
           
           //Advance leading edge.
-          CalculateNextLeadingEdge(Current.Instants.z(), Current.LeadingEdge,
+          CalculateNextLeadingEdge(Current.Instants.z(), *h,
+            Current.LeadingEdge, Current.LeadingProfile, Current.LeadingBody,
             Current.InstantPositions.Add(Current.LastInstantPosition()));
         }
         
@@ -483,7 +542,8 @@ namespace bellebonnesage { namespace modern
           
           //Advance leading edge.
           prim::number FurthestRight =
-            CalculateNextLeadingEdge(Current.Instants.z(), Current.LeadingEdge,
+            CalculateNextLeadingEdge(Current.Instants.z(), *h,
+            Current.LeadingEdge, Current.LeadingProfile, Current.LeadingBody,
             Current.InstantPositions.Add(Current.LastInstantPosition()));
           
           prim::Debug >> i << ": " << FurthestRight;
@@ -56,10 +56,183 @@ namespace bellebonnesage { namespace modern
     ///Array of the stamp graphics painted in the last paint call.
     prim::Array<StampGraphic*> PaintedStampGraphics;
     
+    /**Grid of the painted stamp graphics on a page. Each cell lists, in
+    painting order, the graphics whose placement overlaps the cell.*/
+    struct PageGrid
+    {
+      ///Bounds of all the graphics on the page.
+      prim::planar::Rectangle Bounds;
+      
+      ///Width and height of each cell.
+      prim::number CellSize;
+      
+      ///Number of columns and rows.
+      prim::count Columns, Rows;
+      
+      ///Start of each cell in the items, with one extra entry at the end.
+      prim::Array<prim::count> CellStart;
+      
+      ///Indices of the painted stamp graphics in each cell.
+      prim::Array<prim::count> Items;
+      
+      ///Initializes an empty grid.
+      PageGrid() : CellSize(1.0), Columns(0), Rows(0) {}
+      
+      ///Returns the column or row of a coordinate, clamped to the grid.
+      static prim::count CellOf(prim::number x, prim::number Origin,
+        prim::number CellSize, prim::count Cells)
+      {
+        prim::count i = (prim::count)prim::Floor((x - Origin) / CellSize);
+        return prim::Min(prim::Max(i, (prim::count)0), Cells - 1);
+      }
+      
+      ///Returns the cell containing a point or -1 if it is off the grid.
+      prim::count CellAt(prim::planar::Vector p) const
+      {
+        if(!Columns || !Bounds.Contains(p))
+          return -1;
+        return CellOf(p.y, Bounds.Bottom(), CellSize, Rows) * Columns +
+          CellOf(p.x, Bounds.Left(), CellSize, Columns);
+      }
+    };
+    
+    ///Grids of the painted stamp graphics indexed by page.
+    prim::Array<PageGrid> PageGrids;
+    
+    /**Next painted stamp graphic with the same node as each painted stamp
+    graphic, or -1 if it is the last one.*/
+    prim::Array<prim::count> NextWithSameNode;
+    
+    ///First painted stamp graphic of each node.
+    prim::Table<graph::MusicNode*, prim::count> FirstWithNode;
+    
+    ///Whether the grids and the node index reflect the painted graphics.
+    bool IsIndexed;
+    
+    ///Returns whether a painted stamp graphic can be selected on a page.
+    static bool IsOnPage(const StampGraphic* s, prim::count PageIndex)
+    {
+      return s->n && s->PlacementPageIndex == PageIndex &&
+        !s->PlacementOnLastPaint.IsEmpty();
+    }
+    
+    /**Builds the page grids and node index from the painted stamp graphics.
+    Each grid has roughly one cell per graphic on its page, so a point lookup
+    only visits the few graphics near it.*/
+    void Index()
+    {
+      //Find the bounds and number of graphics on each page.
+      PageGrids.Clear();
+      prim::Array<prim::count> GraphicsOnPage;
+      for(prim::count i = 0; i < PaintedStampGraphics.n(); i++)
+      {
+        const StampGraphic* s = PaintedStampGraphics[i];
+        prim::count Page = s->PlacementPageIndex;
+        if(Page < 0 || !IsOnPage(s, Page))
+          continue;
+        while(PageGrids.n() <= Page)
+        {
+          PageGrids.Add();
+          GraphicsOnPage.Add() = 0;
+        }
+        PageGrids[Page].Bounds += s->PlacementOnLastPaint;
+        GraphicsOnPage[Page]++;
+      }
+      
+      //Size the cells of each page.
+      const prim::count MaximumCells = 256;
+      for(prim::count p = 0; p < PageGrids.n(); p++)
+      {
+        PageGrid& g = PageGrids[p];
+        if(!GraphicsOnPage[p])
+          continue;
+        prim::number Width = g.Bounds.Width(), Height = g.Bounds.Height();
+        g.CellSize = prim::Sqrt(Width * Height /
+          (prim::number)GraphicsOnPage[p]);
+        g.CellSize = prim::Max(g.CellSize,
+          prim::Max(Width, Height) / (prim::number)MaximumCells);
+        if(!(g.CellSize > 0.0))
+          g.CellSize = 1.0;
+        g.Columns = prim::Min((prim::count)(Width / g.CellSize) + 1,
+          MaximumCells);
+        g.Rows = prim::Min((prim::count)(Height / g.CellSize) + 1,
+          MaximumCells);
+        g.CellStart.n(g.Columns * g.Rows + 1);
+        g.CellStart.Zero();
+      }
+      
+      /*Count the graphics in each cell, then fill the cells. Graphics are
+      visited in painting order so that each cell lists them in that order.*/
+      for(prim::count Pass = 0; Pass < 2; Pass++)
+      {
+        for(prim::count i = 0; i < PaintedStampGraphics.n(); i++)
+        {
+          const StampGraphic* s = PaintedStampGraphics[i];
+          prim::count Page = s->PlacementPageIndex;
+          if(Page < 0 || !IsOnPage(s, Page))
+            continue;
+          PageGrid& g = PageGrids[Page];
+          const prim::planar::Rectangle& r = s->PlacementOnLastPaint;
+          prim::count x1 = PageGrid::CellOf(r.Left(), g.Bounds.Left(),
+            g.CellSize, g.Columns);
+          prim::count x2 = PageGrid::CellOf(r.Right(), g.Bounds.Left(),
+            g.CellSize, g.Columns);
+          prim::count y1 = PageGrid::CellOf(r.Bottom(), g.Bounds.Bottom(),
+            g.CellSize, g.Rows);
+          prim::count y2 = PageGrid::CellOf(r.Top(), g.Bounds.Bottom(),
+            g.CellSize, g.Rows);
+          for(prim::count y = y1; y <= y2; y++)
+          {
+            for(prim::count x = x1; x <= x2; x++)
+            {
+              prim::count Cell = y * g.Columns + x;
+              if(!Pass)
+                g.CellStart[Cell + 1]++;
+              else
+                g.Items[g.CellStart[Cell + 1]++] = i;
+            }
+          }
+        }
+        
+        /*After counting, turn the counts into starts. Each cell start is
+        stored one ahead while filling so that it ends up in place.*/
+        for(prim::count p = 0; p < PageGrids.n(); p++)
+        {
+          PageGrid& g = PageGrids[p];
+          if(!g.CellStart.n())
+            continue;
+          if(!Pass)
+          {
+            for(prim::count c = 1; c < g.CellStart.n(); c++)
+              g.CellStart[c] += g.CellStart[c - 1];
+            g.Items.n(g.CellStart.z());
+            for(prim::count c = g.CellStart.n() - 1; c > 0; c--)
+              g.CellStart[c] = g.CellStart[c - 1];
+          }
+        }
+      }
+      
+      //Link the painted stamp graphics of each node together.
+      FirstWithNode.Clear();
+      NextWithSameNode.n(PaintedStampGraphics.n());
+      for(prim::count i = PaintedStampGraphics.n() - 1; i >= 0; i--)
+      {
+        NextWithSameNode[i] = -1;
+        if(graph::MusicNode* n = PaintedStampGraphics[i]->n)
+        {
+          NextWithSameNode[i] = FirstWithNode[n];
+          FirstWithNode[n] = i;
+        }
+      }
+      
+      IsIndexed = true;
+    }
+    
     public:
     
     ///Initializes the click-through manager.
-    ClickThroughManager() : CycleThroughIndex(0) {}
+    ClickThroughManager() : CycleThroughIndex(0), FirstWithNode(-1),
+      IsIndexed(false) {}
     
     ///Clears the current selection.
     void ClearSelection()
@@ -77,6 +250,7 @@ namespace bellebonnesage { namespace modern
     void ClearStampGraphicsCache()
     {
       PaintedStampGraphics.Clear();
+      IsIndexed = false;
     }
     
     ///Adds a stamp graphic to the manager.
@@ -84,6 +258,7 @@ namespace bellebonnesage { namespace modern
     {
       if(!s) return;
       PaintedStampGraphics.Add() = s;
+      IsIndexed = false;
     }
     
     /**Returns the stamp graphic given a page coordinate in inches. Note that
@@ -94,16 +269,29 @@ namespace bellebonnesage { namespace modern
     rotate through the available ones. The rotation is accomplished by setting
     stamp graphics to least-preferred following selection, and the selector
     always chooses the most-preferred to return and makes the graphic
-    least-preferred for the subsequent call.*/
+    least-preferred for the subsequent call. Only the graphics in the grid cell
+    containing the coordinate are considered, and the grid is rebuilt on the
+    first selection after the painted graphics change.*/
     StampGraphic* MakeSelection(prim::count PageIndex, Inches PageCoordinate)
     {
+      //Look up the grid cell containing the coordinate.
+      if(!IsIndexed)
+        Index();
+      if(PageIndex < 0 || PageIndex >= PageGrids.n())
+        return 0;
+      const PageGrid& Grid = PageGrids[PageIndex];
+      prim::count Cell = Grid.CellAt(PageCoordinate);
+      if(Cell < 0)
+        return 0;
+      
       //Look for a selection using the cycle-through algorithm.
       StampGraphic* MostPreferred = 0;
       prim::count LowestClickValue = 0;
-      for(prim::count i = 0; i < PaintedStampGraphics.n(); i++)
+      for(prim::count c = Grid.CellStart[Cell]; c < Grid.CellStart[Cell + 1];
+        c++)
       {
         //Get the next stamp graphic.
-        StampGraphic* Current = PaintedStampGraphics[i];
+        StampGraphic* Current = PaintedStampGraphics[Grid.Items[c]];
         
         //Skip stamp graphics that do not contain the coordinate.
         if(PageIndex != Current->PlacementPageIndex ||
@@ -134,8 +322,9 @@ namespace bellebonnesage { namespace modern
       /*Transfer related selections. For example, clicking on a flag might
       also select the note depending on whether the underlying node is the
       same.*/
-      for(prim::count i = 0; i < PaintedStampGraphics.n(); i++)
-        PaintedStampGraphics[i]->TransferSelected(Selected);
+      for(prim::count i = FirstWithNode[Selected->n]; i >= 0;
+        i = NextWithSameNode[i])
+          PaintedStampGraphics[i]->TransferSelected(Selected);
       
       //Return the selected graphic.
       return Selected;
@@ -62,6 +62,13 @@ namespace bellebonnesage { namespace modern
     ///Strokes the path with the width instead of filling it.
     prim::number StrokeWidth;
     
+    ///Whether the graphic knocks out any staff lines passing behind it.
+    bool KnockOut;
+    
+    /**Whether the graphic is the body of the stamp, such as a notehead, rest or
+    tab number. Later instants on the part are kept clear of it.*/
+    bool Body;
+    
     ///Graph node related to the graphic.
     graph::MusicNode* n;
     
@@ -137,7 +144,7 @@ namespace bellebonnesage { namespace modern
 
       //Paint the stamp graphic.
       if(p2)
-        Painter->Draw(*p2, a);
+        Painter->DrawShared(*p2, a);
       else if(t)
       {
         Painter->Transform(Affine::Scale(20.0));
@@ -155,7 +162,37 @@ namespace bellebonnesage { namespace modern
     
     ///Constructor to zero the text pointer.
     StampGraphic() : c(bellebonnesage::Colors::black), p2(0), t(0),
-     StrokeWidth(0.0), n(0), PlacementPageIndex(-1), ClickIndex(0) {}
+     StrokeWidth(0.0), KnockOut(false), Body(false), n(0), PlacementPageIndex(-1),
+     ClickIndex(0) {}
+    
+    ///Copy constructor shares the path and deep copies the text.
+    StampGraphic(const StampGraphic& Other) : t(0)
+    {
+      *this = Other;
+    }
+    
+    /**Assignment operator shares the path and deep copies the text. The path
+    geometry is copied only if one of the graphics later changes it.*/
+    StampGraphic& operator = (const StampGraphic& Other)
+    {
+      if(this == &Other)
+        return *this;
+      p = Other.p;
+      c = Other.c;
+      p2 = Other.p2;
+      a = Other.a;
+      delete t;
+      t = Other.t ? new bellebonnesage::Text(*Other.t) : 0;
+      StrokeWidth = Other.StrokeWidth;
+      KnockOut = Other.KnockOut;
+      Body = Other.Body;
+      n = Other.n;
+      PlacementOnLastPaint = Other.PlacementOnLastPaint;
+      PlacementOrigin = Other.PlacementOrigin;
+      PlacementPageIndex = Other.PlacementPageIndex;
+      ClickIndex = Other.ClickIndex;
+      return *this;
+    }
     
     ///Destructor to delete the text pointer.
     ~StampGraphic() {delete t;}
@@ -176,10 +213,31 @@ namespace bellebonnesage { namespace modern
     ///Indicates the parent on which this stamp was placed.
     graph::MusicNode* Parent;
     
+    private:
+    
+    ///Cached bounds of the stamp graphics without any transform.
+    mutable prim::planar::Rectangle LocalBounds;
+    
+    ///Cached bounds of the stamp in the context they were calculated for.
+    mutable prim::planar::Rectangle ContextBounds;
+    
+    ///The context that the cached context bounds were calculated for.
+    mutable bellebonnesage::Affine ContextOfBounds;
+    
+    ///Whether the local bounds are cached.
+    mutable bool HasLocalBounds;
+    
+    ///Whether the context bounds are cached.
+    mutable bool HasContextBounds;
+    
+    public:
+    
     ///Copy constructor to deep copy the stamp.
-    Stamp(const Stamp& Other) : graph::MusicNode::TypesettingInfo(Other)
+    Stamp(const Stamp& Other) : graph::MusicNode::TypesettingInfo(Other),
+      HasLocalBounds(false), HasContextBounds(false)
     {
-      //Make deep-copies of the stamp graphic.
+      /*Make deep-copies of the stamp graphics. Their paths share geometry with
+      the originals until either is changed.*/
       for(prim::count i = 0; i < Other.Graphics.n(); i++)
         Add() = *Other.Graphics[i];
       
@@ -189,9 +247,19 @@ namespace bellebonnesage { namespace modern
       Parent = Other.Parent;
     }
     
+    /**Gives each graphic its own copy of its path geometry. Afterwards the
+    stamp shares only cached paths with other stamps, so it can be painted on
+    another thread while the stamps it was copied from change.*/
+    void Unshare()
+    {
+      for(prim::count i = 0; i < Graphics.n(); i++)
+        Graphics[i]->p.CopyFrom(Graphics[i]->p);
+    }
+    
     ///Adds a stamp graphic.
     StampGraphic& Add()
     {
+      InvalidateBounds();
       return *(Graphics.Add() = new StampGraphic);
     }
 
@@ -212,6 +280,7 @@ namespace bellebonnesage { namespace modern
     {
       NeedsTypesetting = true;
       Graphics.ClearAndDeleteAll();
+      InvalidateBounds();
       Context = Affine::Unit();
       Parent = WithParent;
     }
@@ -238,19 +307,84 @@ namespace bellebonnesage { namespace modern
 #endif
     }
   
-    ///Gets the bounds of the stamp.
+    /**Discards the cached bounds. This must be called if the graphics are
+    changed directly after their bounds have been requested. Changes to the
+    context are detected automatically.*/
+    void InvalidateBounds()
+    {
+      HasLocalBounds = HasContextBounds = false;
+    }
+    
+    /**Gets the bounds of the stamp. The untransformed bounds are cached, so
+    for transforms that keep rectangles axis-aligned (such as translations
+    and scales) the graphics do not need to be visited again.*/
     prim::planar::Rectangle Bounds(Affine a = Affine::Unit()) const
     {
+      if(!HasLocalBounds)
+      {
+        prim::planar::Rectangle r;
+        for(prim::count i = 0; i < Graphics.n(); i++)
+          r = r + Graphics[i]->Bounds();
+        LocalBounds = r;
+        HasLocalBounds = true;
+      }
+      
+      if(a.IsRectilinear())
+        return a << LocalBounds;
+      
       prim::planar::Rectangle r;
       for(prim::count i = 0; i < Graphics.n(); i++)
         r = r + Graphics[i]->Bounds(a);
       return r;
     }
     
+    /**Gets the bounds of the graphics that make up the body of the stamp. If
+    no graphic is marked as the body, then the whole stamp is the body.*/
+    prim::planar::Rectangle BodyBounds() const
+    {
+      prim::planar::Rectangle r;
+      for(prim::count i = 0; i < Graphics.n(); i++)
+        if(Graphics[i]->Body)
+          r = r + Graphics[i]->Bounds();
+      return r.IsEmpty() ? Bounds() : r;
+    }
+    
     ///Gets the bounds of the stamp in the current context.
     prim::planar::Rectangle BoundsInContext() const
     {
-      return Bounds(Context);
+      if(!HasContextBounds || ContextOfBounds != Context)
+      {
+        ContextBounds = Bounds(Context);
+        ContextOfBounds = Context;
+        HasContextBounds = true;
+      }
+      return ContextBounds;
+    }
+    
+    /**Adds the outlines of the stamp graphics to a skyline. Stroked graphics
+    and graphics without outlines (such as text) are added by their bounds.*/
+    void AddToSkyline(Skyline& s, Affine a = Affine::Unit()) const
+    {
+      for(prim::count i = 0; i < Graphics.n(); i++)
+      {
+        const StampGraphic& g = *Graphics[i];
+        const bellebonnesage::Path& p = g.p2 ? *g.p2 : g.p;
+        if(g.StrokeWidth || !p.Outline().n())
+          s.AddRectangle(g.Bounds(a));
+        else
+          s.AddPath(p, a * g.a);
+      }
+    }
+    
+    /**Returns the approximate number of bytes used by the stamp graphics and
+    their paths. Cached paths shared with other stamps are not counted.*/
+    prim::count Bytes() const
+    {
+      prim::count b = (prim::count)sizeof(Stamp);
+      for(prim::count i = 0; i < Graphics.n(); i++)
+        b += (prim::count)(sizeof(StampGraphic*) + sizeof(StampGraphic) -
+          sizeof(Path)) + Graphics[i]->p.Bytes();
+      return b;
     }
     
     ///Constructor creates a blank stamp.
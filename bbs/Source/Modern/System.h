@@ -66,6 +66,12 @@ namespace bellebonnesage { namespace modern
     ///The current leading edge.
     prim::Array<prim::number> LeadingEdge;
     
+    ///The right-hand profile of the stamps placed so far on each part.
+    prim::Array<Skyline> LeadingProfile;
+    
+    ///The right edge of the bodies of the stamps placed so far on each part.
+    prim::Array<prim::number> LeadingBody;
+    
     ///Staff heights.
     prim::Array<prim::number> StaffHeights;
     
@@ -84,6 +90,32 @@ namespace bellebonnesage { namespace modern
     ///The final bounds of the system.
     prim::planar::Rectangle Bounds;
     
+    /**Copies another system so that it can be painted on another thread. The
+    stamps and their paths are copied, so only the cached paths that the
+    stamps refer to are shared with the original.*/
+    void DeepCopyFrom(const System& Other)
+    {
+      Instants.RemoveAll();
+      for(prim::count i = 0; i < Other.Instants.n(); i++)
+      {
+        StampInstant& Instant = Instants.Add();
+        Instant.DeepCopyFrom(Other.Instants[i]);
+        for(prim::count j = 0; j < Instant.n(); j++)
+          if(Instant[j])
+            Instant[j]->Unshare();
+      }
+      InstantPositions = Other.InstantPositions;
+      LeadingEdge = Other.LeadingEdge;
+      LeadingProfile = Other.LeadingProfile;
+      LeadingBody = Other.LeadingBody;
+      StaffHeights = Other.StaffHeights;
+      HasStaffLines = Other.HasStaffLines;
+      Staves = Other.Staves;
+      SystemHeight = Other.SystemHeight;
+      MinimumSystemWidth = Other.MinimumSystemWidth;
+      Bounds = Other.Bounds;
+    }
+    
     ///Gets the last known instant position.
     prim::number LastInstantPosition() const
     {
@@ -222,6 +254,7 @@ namespace bellebonnesage { namespace modern
               //Hack: constant should come from house style.
               for(prim::count k = 0; k < s->Graphics.n(); k++)
                 s->Graphics[k]->a *= Affine::Scale(0.8);
+              s->InvalidateBounds();
             }
           }
         }
@@ -266,6 +299,84 @@ namespace bellebonnesage { namespace modern
       }
     }
     
+    ///Horizontal extent of a gap in a staff line.
+    struct StaffLineGap
+    {
+      prim::number Left;
+      prim::number Right;
+      
+      //Sorting operators
+      bool operator < (const StaffLineGap& Other) const
+      {
+        return Left < Other.Left;
+      }
+      
+      bool operator > (const StaffLineGap& Other) const
+      {
+        return Left > Other.Left;
+      }
+    };
+    
+    /**Paints the lines of a tab staff as segmented paths. Each line is left
+    open wherever a knock-out graphic (a tab number) crosses it, so that the
+    numbers do not need an opaque background to mask the line.*/
+    void PaintTabStaffLines(Painter& Painter, prim::count Staff,
+      prim::number Right, prim::number LineThickness,
+      prim::number TabSpaceRatio)
+    {
+      //Space to leave on either side of a tab number.
+      prim::number Margin = TabSpaceRatio / 4.0;
+      
+      //Gather the bounds of the knock-out graphics on the staff.
+      prim::Array<prim::planar::Rectangle> KnockOuts;
+      for(prim::count i = 0; i < Instants.n(); i++)
+      {
+        if(Staff >= Instants[i].n()) continue;
+        if(prim::Pointer<Stamp> s = Instants[i][Staff])
+        {
+          for(prim::count k = 0; k < s->Graphics.n(); k++)
+            if(s->Graphics[k]->KnockOut)
+              KnockOuts.Add() = s->Graphics[k]->Bounds(s->Context);
+        }
+      }
+      
+      prim::number LineRange = (Staves[Staff].Lines - 1) * 0.5;
+      for(prim::number j = -LineRange; j <= LineRange; j++)
+      {
+        prim::number y = StaffHeights[Staff] + j * TabSpaceRatio;
+        
+        //Find the gaps in this line.
+        prim::Sortable::Array<StaffLineGap> Gaps;
+        for(prim::count k = 0; k < KnockOuts.n(); k++)
+        {
+          const prim::planar::Rectangle& r = KnockOuts[k];
+          if(y < r.Bottom() - Margin || y > r.Top() + Margin) continue;
+          Gaps.Add().Left = r.Left() - Margin;
+          Gaps.z().Right = r.Right() + Margin;
+        }
+        Gaps.Sort();
+        
+        //Build the line out of the segments between the gaps.
+        Path p;
+        prim::number Start = LineThickness * 0.5;
+        prim::number End = Right - LineThickness * 0.5;
+        for(prim::count k = 0; k < Gaps.n(); k++)
+        {
+          prim::number GapLeft = prim::Min(Gaps[k].Left, End);
+          if(GapLeft > Start)
+            Shapes::AddLine(p, prim::planar::Vector(Start, y),
+              prim::planar::Vector(GapLeft, y), LineThickness);
+          Start = prim::Max(Start, Gaps[k].Right);
+        }
+        if(End > Start)
+          Shapes::AddLine(p, prim::planar::Vector(Start, y),
+            prim::planar::Vector(End, y), LineThickness);
+        
+        if(p.n())
+          Painter.Draw(p);
+      }
+    }
+    
     public:
     
     ///Paints the system.
@@ -283,6 +394,18 @@ namespace bellebonnesage { namespace modern
       Painter.Translate(BottomLeftPosition);
       Painter.Scale(SpaceHeight);
       
+      //Skip the whole system if it is outside of the view.
+      if(!System::Bounds.IsEmpty())
+      {
+        prim::planar::Rectangle Visible = System::Bounds;
+        Visible.Dilate(LineThickness);
+        if(!Painter.IsVisible(Visible))
+        {
+          Painter.Revert(2);
+          return;
+        }
+      }
+      
       /*Quickly calculate the bounds to determine where staff lines should be
       painted. Note the i += Instants.n() - 1 optimization.*/
       prim::planar::Rectangle Bounds;
@@ -305,6 +428,14 @@ namespace bellebonnesage { namespace modern
           {
             if(!HasStaffLines[i]) continue;
 
+            //Tab staff lines are broken around the tab numbers.
+            if(Staves[i].IsTab)
+            {
+              PaintTabStaffLines(Painter, i, Bounds.Right(), LineThickness,
+                TabSpaceRatio);
+              continue;
+            }
+
             prim::number lineRange = (Staves[i].Lines - 1) * 0.5;
 
             for(prim::number j = -lineRange; j <= lineRange; j++)
@@ -318,6 +449,14 @@ namespace bellebonnesage { namespace modern
       //Paint the stamps in the system.
       for(prim::count i = 0; i < Instants.n(); i++)
       {
+        //Skip instants that are outside of the view.
+        prim::planar::Rectangle InstantBounds;
+        for(prim::count j = 0; j < Instants[i].n(); j++)
+          if(prim::Pointer<Stamp> s = Instants[i][j])
+            InstantBounds += s->BoundsInContext();
+        if(!InstantBounds.IsEmpty() && !Painter.IsVisible(InstantBounds))
+          continue;
+        
         for(prim::count j = 0; j < Instants[i].n(); j++)
         {
           if(prim::Pointer<Stamp> s = Instants[i][j])
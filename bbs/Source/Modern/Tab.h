@@ -9,7 +9,7 @@ namespace bellebonnesage { namespace modern
   struct Tab
   {
     ///Constructor
-    Tab() : NumStrings(0), Duration(1, 4), IsRest(false), 
+    Tab() : NumStrings(0), UsedStrings(0), Duration(1, 4), IsRest(false), 
       OriginalNode(0), State(0) {}
 
     ///Convert ChordToken to Tablature
@@ -57,7 +57,8 @@ namespace bellebonnesage { namespace modern
 
           /**If the string hasn't be used, check if the note can be played 
           on that string, and if so, add it*/
-          if (!UsedStrings.Contains(StringIndex))
+          if (!graph::StringedInstrument::IsStringInSet (UsedStrings, 
+            StringIndex))
           {
             prim::count Fret = 
               State->ActiveInstrument->GetPostionOnStringForNote(
@@ -71,7 +72,8 @@ namespace bellebonnesage { namespace modern
               TabNotes.z().LineSpace = Utility::GetLineSpaceForTabbedNote(
                 TabNotes.z().StringIndex, NumStrings);
               TabNotes.z().OriginalNode = a[i];
-              UsedStrings.Add(StringIndex);
+              graph::StringedInstrument::AddStringToSet (UsedStrings, 
+                StringIndex);
               FoundValidPosition = true;
             }
           }
@@ -98,7 +100,8 @@ namespace bellebonnesage { namespace modern
           // If any of the available strings haven't been used, add the note
           for (prim::count j = 0; j < AvailableStrings.n(); ++j)
           {
-            if (!UsedStrings.Contains(AvailableStrings.ith (j)))
+            if (!graph::StringedInstrument::IsStringInSet (UsedStrings, 
+              AvailableStrings.ith (j)))
             {
               TabNotes.Add().MidiNote = MidiNote;
               TabNotes.z().StringIndex = AvailableStrings.ith (j);
@@ -109,7 +112,8 @@ namespace bellebonnesage { namespace modern
                 Utility::GetLineSpaceForTabbedNote(TabNotes.z().StringIndex, 
                 NumStrings);
               TabNotes.z().OriginalNode = WrongNotes[i];
-              UsedStrings.Add(TabNotes.z().StringIndex);
+              graph::StringedInstrument::AddStringToSet (UsedStrings, 
+                TabNotes.z().StringIndex);
               FixedNotes.Add(WrongNotes[i]);
               break;
             }
@@ -147,8 +151,8 @@ namespace bellebonnesage { namespace modern
       if (EngraveRests) EngraveRest (s, TabBounds, h, t);
       if (EngraveRhythm && !IsRest)
       {
-        EngraveStem (s, TabBounds, h);
-        EngraveFlags (s, TabBounds, t);
+        EngraveStem (s, TabBounds, h, c);
+        EngraveFlags (s, TabBounds, c);
         EngraveDots (s, h, c);
       }
     }
@@ -174,29 +178,22 @@ namespace bellebonnesage { namespace modern
           prim::number HorizontalPosition = 
             (TabNotes[i].Fret > 9 ? -(margin / 2.0) : 0) - margin;
 
-          //Draw number text so we can get the bounds
+          /*Draw the number. Rather than painting a background behind it, the
+          number knocks out the tab staff lines when the system is painted.*/
           prim::String t = prim::String (TabNotes[i].Fret);
           Painter::Draw(s.Add().p, t, f, 72.0 * h.TabSpaceHeightRatio, 
             Font::Regular, Text::Justifications::Full);
           s.z().a = Affine::Translate(prim::planar::Vector(
             HorizontalPosition, VerticalPosition));
+          s.z().KnockOut = true;
+          s.z().Body = true;
 
+          //Include the margin that will be cleared around the number.
           prim::planar::Rectangle NumberBounds = s.z().Bounds();
           NumberBounds += prim::planar::Rectangle (
             NumberBounds.Left() - margin, VerticalPosition, 
             NumberBounds.Right() + margin, VerticalPosition);
-                    
-          //Add a white background 
-          Shapes::AddRectangle(s.Add().p, NumberBounds);
-          s.z().c = Colors::white;
-          b += s.z().Bounds();
-
-          //Redraw the number on top of the white background
-          Painter::Draw(s.Add().p, t, f, 72.0 * h.TabSpaceHeightRatio, 
-            Font::Regular, Text::Justifications::Full);
-          s.z().a = Affine::Translate(prim::planar::Vector(
-            HorizontalPosition, VerticalPosition));
-          b += s.z().Bounds();
+          b += NumberBounds;
 
           s.z().n = TabNotes[i].OriginalNode;
 
@@ -237,6 +234,7 @@ namespace bellebonnesage { namespace modern
         TabNotes.a().LineSpace, NumStrings, h) * h.TabSpaceHeightRatio)) 
         * Affine::Scale(4.0);
       s.z().n = TabNotes.a().OriginalNode;
+      s.z().Body = true;
       
       //Update the bounding box.
       if(s.z().p2)
@@ -244,7 +242,7 @@ namespace bellebonnesage { namespace modern
     }
     
     ///Engrave the tab stem
-    void EngraveStem (Stamp& s, Path& Bounds, const House& h)
+    void EngraveStem (Stamp& s, Path& Bounds, const House& h, const Cache& c)
     {
       if(!TabNotes.n() || Duration >= 1) return;
 
@@ -260,43 +258,47 @@ namespace bellebonnesage { namespace modern
       if (Duration >= prim::Ratio(1, 2))
         StemStart.y = FlagPosition.y + (h.TabStemHeight / 2);
 
-      Shapes::AddLine(s.Add().p, StemStart, FlagPosition, h.StemWidth);
+      //Stretch the cached unit stem from the flag up to the stem start.
+      s.Add().p2 = c[Cache::TabStem];
+      s.z().a = Affine::Translate(FlagPosition) * Affine::Scale(
+        prim::planar::Vector(1.0, StemStart.y - FlagPosition.y));
+
+      //Round off both ends of the stem.
+      s.Add().p2 = c[Cache::TabStemCap];
+      s.z().a = Affine::Translate(FlagPosition);
+      s.Add().p2 = c[Cache::TabStemCap];
+      s.z().a = Affine::Translate(StemStart);
       FlagPosition.x += (h.StemWidth / 2);
     }
 
     ///Engrave the tab flags
-    void EngraveFlags (Stamp& s, Path& Bounds, const Typeface& t)
+    void EngraveFlags (Stamp& s, Path& Bounds, const Cache& c)
     {
       if(!TabNotes.n()) return;
 
-      prim::planar::Rectangle b;
-
+      /*Use the cached stacks of flags. Rhythms with more flags than the
+      largest stack continue with further stacks above it.*/
+      const prim::count MostFlags = Cache::TabFlagsFive - Cache::TabFlagsOne + 1;
       prim::count Flags = Utility::CountFlags(Duration);
       prim::planar::Vector f = FlagPosition;
-
-      for(prim::count i = 0; i < Flags; i++)
+      while(Flags > 0)
       {
-        //Add the flag to the stamp.
-        s.Add().p2 = t.LookupGlyph(87);
-        s.z().a = Affine::Translate (f) * Affine::Scale(4.0);
+        prim::count Stacked = prim::Min(Flags, MostFlags);
+        s.Add().p2 = c[Cache::TabFlagsOne + Stacked - 1];
+        s.z().a = Affine::Translate(f);
 
         if(TabNotes.n() == 1)
           s.z().n = TabNotes.a().OriginalNode;
         else
           s.z().n = OriginalNode;
-        
-        //Flip the stem direction for stem down (flag up).
-        s.z().a = s.z().a * Affine::Scale (prim::planar::Vector(1.0, -1.0));
-        b += s.z().Bounds();
-        
-        /*Flag positions do not take into account the line-space position
-        mapping. Instead, they are spaced equally by one space height.*/
-        f.y += 1;
 
         //Add the flag bounds.
-        Path p;
-        Shapes::AddRectangle(p, b);
-        Bounds.Append(p);
+        Shapes::AddRectangle(Bounds, s.z().Bounds());
+
+        /*Flag positions do not take into account the line-space position
+        mapping. Instead, they are spaced equally by one space height.*/
+        f.y += (prim::number)Stacked;
+        Flags -= Stacked;
       }
     }
     
@@ -396,8 +398,8 @@ namespace bellebonnesage { namespace modern
     ///List of tabbed notes. 
     TabNoteList TabNotes;
 
-    ///Array of used string indexes
-    prim::Array<int> UsedStrings;
+    ///Set of used string indexes
+    graph::StringedInstrument::StringSet UsedStrings;
 
     /**Array of notes that were unable to be mapped to Tablature.
     This can happen if the string of the note is invalid or already 
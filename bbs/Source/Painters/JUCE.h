@@ -57,6 +57,10 @@ namespace bellebonnesage { namespace painters
       Inches PageDimensions;
       prim::planar::RectangleInt PageVisibility;
       prim::planar::RectangleInt PageArea;
+      
+      /**Size of the target in pixels when there is no component, for example
+      when painting to an image.*/
+      prim::planar::VectorInt TargetSize;
 
       public:
       
@@ -96,6 +100,33 @@ namespace bellebonnesage { namespace painters
     
     ///Saves the portfolio pointer during painting so draw calls can access it.
     Portfolio* CachedPortfolio;
+    
+    private:
+    
+    ///Transform from page space to the component, computed once per paint.
+    juce::AffineTransform PageTransform;
+    
+    ///Rectangle of the component, computed once per paint.
+    prim::planar::Rectangle Viewport;
+    
+    ///Fill color of the raster state converted to JUCE.
+    juce::Colour FillColour;
+    
+    ///Stroke color of the raster state converted to JUCE.
+    juce::Colour StrokeColour;
+    
+    /**Consecutive fills of the same color that do not overlap, already
+    transformed to the component. They are filled in one call when the color
+    changes, an overlapping path is filled, or anything else is drawn.*/
+    juce::Path FillBatch;
+    
+    ///Color of the fills in the batch.
+    juce::Colour FillBatchColour;
+    
+    ///Bounds of the fills in the batch in component coordinates.
+    prim::planar::Rectangle FillBatchBounds;
+    
+    public:
 
     ///Constructor initializes the JUCE renderer.
     JUCE() : JUCEProperties(0), CachedPortfolio(0) {}
@@ -110,6 +141,10 @@ namespace bellebonnesage { namespace painters
       //Get a pointer to the properties.
       JUCEProperties = PortfolioProperties->Interface<Properties>();
 
+      //Cache the page transform and the visible part of the component.
+      PageTransform = GetPageTransform();
+      Viewport = GetVisibleArea();
+      
       //Set the current page number.
       SetPageNumber(JUCEProperties->IndexOfCanvas);
       
@@ -117,6 +152,9 @@ namespace bellebonnesage { namespace painters
       PortfolioToPaint->Canvases[JUCEProperties->IndexOfCanvas]->Paint(*this,
         *PortfolioToPaint);
       
+      //Fill anything left in the batch.
+      FlushFills();
+      
       //Reset the page number to indicate painting is finished.
       ResetPageNumber();
 
@@ -129,53 +167,119 @@ namespace bellebonnesage { namespace painters
     
     private:
     
-    juce::AffineTransform GetTransform(const Affine& a = Affine::Unit())
+    ///Converts a color to JUCE.
+    static juce::Colour ToColour(const Color& c)
+    {
+      return juce::Colour((prim::uint8)(c.R * 255.f), (prim::uint8)(c.G * 255.f),
+        (prim::uint8)(c.B * 255.f), c.A);
+    }
+    
+    ///Returns the transform from bottom-left origin page space to the component.
+    juce::AffineTransform GetPageTransform()
     {
       //Determine dimensions of the current canvas and the appropriate scale.
       prim::planar::Vector PageDimensions = JUCEProperties->PageDimensions;
       prim::number ScaleToFitPage =
         (prim::number)JUCEProperties->PageArea.Width() / PageDimensions.x;
-
+      
+      return juce::AffineTransform::translation(0.f,
+        (float)-PageDimensions.y).scaled((float)ScaleToFitPage,
+        (float)-ScaleToFitPage).translated(
+        (float)JUCEProperties->PageArea.a.x,
+        (float)GetTargetSize().y - 
+        (float)JUCEProperties->PageArea.b.y);
+    }
+    
+    juce::AffineTransform GetTransform(const Affine& a = Affine::Unit())
+    {
       //Calculate the affine transform so that the image is scaled to the page.
-      Affine m = Spaces.Forwards();
+      Affine m = CurrentSpace();
       m *= a;
       
-      //Convert transform to JUCE.
-      juce::AffineTransform jat(
+      //Convert transform to JUCE and follow it with the page transform.
+      return juce::AffineTransform(
         (float)m.a, (float)m.c, (float)m.e,
-        (float)m.b, (float)m.d, (float)m.f);
-      
-      //Transform to bottom-left origin space.
-      jat = jat.translated((float)0, (float)-PageDimensions.y);
-      jat = jat.scaled((float)ScaleToFitPage, (float)-ScaleToFitPage);
-      jat = jat.translated((float)JUCEProperties->PageArea.a.x,
-        (float)JUCEProperties->ComponentContext->getHeight() - 
-        (float)JUCEProperties->PageArea.b.y);
+        (float)m.b, (float)m.d, (float)m.f).followedBy(PageTransform);
+    }
+    
+    ///Returns the size in pixels of the component or image being painted.
+    prim::planar::VectorInt GetTargetSize()
+    {
+      if(juce::Component* c = JUCEProperties->ComponentContext)
+        return prim::planar::VectorInt(c->getWidth(), c->getHeight());
+      return JUCEProperties->TargetSize;
+    }
+    
+    /**Returns the area of the component that needs painting. This is the
+    page visibility if one was given, and otherwise the whole component.*/
+    prim::planar::Rectangle GetVisibleArea()
+    {
+      prim::planar::VectorInt Size = GetTargetSize();
+      prim::number Height = (prim::number)Size.y;
+      prim::planar::Rectangle Component(prim::planar::Vector(),
+        prim::planar::Vector((prim::number)Size.x, Height));
       
-      return jat;
+      //Page visibility has a bottom-left origin like the page area.
+      prim::planar::RectangleInt v = JUCEProperties->PageVisibility;
+      if(v.IsEmpty())
+        return Component;
+      v.Order();
+      return Component - prim::planar::Rectangle(
+        (prim::number)v.a.x, Height - (prim::number)v.b.y,
+        (prim::number)v.b.x, Height - (prim::number)v.a.y);
     }
     
-    ///Determines whether an object given a rectangle bound needs painting.
-    bool IsInsideComponent(prim::planar::Rectangle ObjectBounds,
+    ///Returns the bounds of an object in the component.
+    prim::planar::Rectangle GetComponentBounds(
+      const prim::planar::Rectangle& ObjectBounds,
       const juce::AffineTransform& a)
     {
       //Get the transform of the viewport.
       Affine ViewportTransform(a.mat00, a.mat10, a.mat01, a.mat11, a.mat02,
         a.mat12);
       
-      //Get the rectangle of the screen.
-      prim::planar::Rectangle Viewport(prim::planar::Vector(),
-        prim::planar::Vector(JUCEProperties->ComponentContext->getWidth(),
-        JUCEProperties->ComponentContext->getHeight()));
-      
-      //Transform the object coordinates into the viewport.
-      ObjectBounds.a = ViewportTransform << ObjectBounds.a;
-      ObjectBounds.b = ViewportTransform << ObjectBounds.b;
-      
+      //Transform each corner so that rotated objects are bounded correctly.
+      prim::planar::Rectangle r(ViewportTransform << ObjectBounds.a);
+      r += ViewportTransform << ObjectBounds.b;
+      r += ViewportTransform << prim::planar::Vector(ObjectBounds.a.x,
+        ObjectBounds.b.y);
+      r += ViewportTransform << prim::planar::Vector(ObjectBounds.b.x,
+        ObjectBounds.a.y);
+      return r;
+    }
+    
+    ///Determines whether an object given a rectangle bound needs painting.
+    bool IsInsideComponent(prim::planar::Rectangle ObjectBounds,
+      const juce::AffineTransform& a)
+    {
       //Return whether the object is inside the component.
-      return !(ObjectBounds - Viewport).IsEmpty();
+      return !(GetComponentBounds(ObjectBounds, a) - Viewport).IsEmpty();
+    }
+    
+    ///Fills the paths collected in the batch.
+    void FlushFills()
+    {
+      if(FillBatch.isEmpty())
+        return;
+      
+      juce::Graphics* g = JUCEProperties->GraphicsContext;
+      g->setColour(FillBatchColour);
+      g->fillPath(FillBatch);
+      FillBatch.clear();
+      FillBatchBounds = prim::planar::Rectangle();
     }
     
+    public:
+    
+    ///Determines whether a rectangle in the current space is in the view.
+    bool IsVisible(const prim::planar::Rectangle& Bounds)
+    {
+      if(!IsInPaintEvent()) return true;
+      return IsInsideComponent(Bounds, GetTransform());
+    }
+    
+    private:
+    
     ///Determines whether this painter is painting now.
     bool IsInPaintEvent()
     {
@@ -184,6 +288,14 @@ namespace bellebonnesage { namespace painters
     
     public:
     
+    ///Converts the colors of the raster state to JUCE once.
+    void SetRasterState(const RasterState& NewState)
+    {
+      State = NewState;
+      FillColour = ToColour(State.FillColor);
+      StrokeColour = ToColour(State.StrokeColor);
+    }
+    
     ///Draws an image.
     void Draw(const Resource& ResourceID, prim::planar::Vector Size)
     {
@@ -223,6 +335,7 @@ namespace bellebonnesage { namespace painters
       juce::Graphics* g = JUCEProperties->GraphicsContext;
 
       //Draw the image.
+      FlushFills();
       g->drawImageTransformed(ImageResource->Handle, ToViewport);
     }
     
@@ -236,31 +349,33 @@ namespace bellebonnesage { namespace painters
       juce::AffineTransform ToViewport = GetTransform(a);
         
       //Optimization: do not draw if path is outside the view.
-      if(!IsInsideComponent(p.Bounds(), ToViewport))
+      prim::planar::Rectangle Bounds =
+        GetComponentBounds(p.Bounds(), ToViewport);
+      if((Bounds - Viewport).IsEmpty())
         return;
       
-      //Get the JUCE graphics context.
-      juce::Graphics* g = JUCEProperties->GraphicsContext;
-
       //Fill path if necessary.
       if(State.FillColor.A > 0.f)
       {
-        //Set the fill color.
-        Color fc = State.FillColor;
-        g->setColour(juce::Colour((prim::uint8)(fc.R * 255.f),
-          (prim::uint8)(fc.G * 255.f), (prim::uint8)(fc.B * 255.f), fc.A));
-
-        //Fill the path.
-        g->fillPath(p, ToViewport);
+        /*Add the path to the batch. Overlapping fills are not merged since
+        their windings could cancel, and translucent overlaps would blend.*/
+        if(FillColour != FillBatchColour ||
+          !(Bounds - FillBatchBounds).IsEmpty())
+            FlushFills();
+        
+        FillBatch.addPath(p.Native(), ToViewport);
+        FillBatchColour = FillColour;
+        FillBatchBounds += Bounds;
       }
 
       //Stroke path if necessary.
       if(State.StrokeColor.A > 0.f)
       {
-        //Set the stroke color.
-        Color sc = State.StrokeColor;
-        g->setColour(juce::Colour((prim::uint8)(sc.R * 255.f),
-          (prim::uint8)(sc.G * 255.f), (prim::uint8)(sc.B * 255.f), sc.A));
+        FlushFills();
+        
+        //Get the JUCE graphics context.
+        juce::Graphics* g = JUCEProperties->GraphicsContext;
+        g->setColour(StrokeColour);
 
         //Determine the affine transform scaled stroke width.
         prim::number ScaledStrokeWidth = State.StrokeWidth *
@@ -268,7 +383,7 @@ namespace bellebonnesage { namespace painters
           ToViewport.mat01).Mag() / prim::Sqrt(2.0);
         
         //Stroke the path.
-        g->strokePath(p, juce::PathStrokeType((float)ScaledStrokeWidth), 
+        g->strokePath(p.Native(), juce::PathStrokeType((float)ScaledStrokeWidth), 
           ToViewport);
       }
     }
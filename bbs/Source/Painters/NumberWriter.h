@@ -0,0 +1,194 @@
+/*
+  ==============================================================================
+
+  Copyright 2007-2013 William Andrew Burnson. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+     1. Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimer.
+
+     2. Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY WILLIAM ANDREW BURNSON ''AS IS'' AND ANY EXPRESS
+  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+  EVENT SHALL WILLIAM ANDREW BURNSON OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+  INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+  OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  The views and conclusions contained in the software and documentation are
+  those of the authors and should not be interpreted as representing official
+  policies, either expressed or implied, of William Andrew Burnson.
+
+  ------------------------------------------------------------------------------
+
+  This file is part of Belle, Bonne, Sage --
+    The 'Beautiful, Good, Wise' C++ Vector-Graphics Library for Music Notation 
+
+  ==============================================================================
+*/
+
+#ifndef BELLEBONNESAGE_PAINTERS_NUMBER_WRITER_H
+#define BELLEBONNESAGE_PAINTERS_NUMBER_WRITER_H
+
+namespace bellebonnesage { namespace painters
+{
+  /**Writes the numbers and operators of a vector content stream to a string.
+  Text is collected in a fixed buffer and appended to the string in large
+  blocks. Numbers are written in fixed-point notation with a given number of
+  decimal places and trailing zeroes removed. Unlike prim::String, no stream
+  is created per number, and the output does not depend on the locale.*/
+  class NumberWriter
+  {
+    ///Size of the internal buffer.
+    static const prim::count BufferSize = 1024;
+
+    ///The most characters that a single number can take up.
+    static const prim::count MaxNumberLength = 32;
+
+    ///The string being written to.
+    prim::String& Target;
+
+    ///Buffer holding text not yet appended to the target.
+    prim::ascii Buffer[BufferSize];
+
+    ///Number of characters in the buffer.
+    prim::count Length;
+
+    ///Number of decimal places to write.
+    prim::count Decimals;
+
+    ///Makes sure there is room for a number of characters in the buffer.
+    void Reserve(prim::count Characters)
+    {
+      if(Length + Characters > BufferSize)
+        Flush();
+    }
+
+    public:
+
+    ///Creates a writer that appends to a string.
+    NumberWriter(prim::String& Target, prim::count Decimals = 5) :
+      Target(Target), Length(0), Decimals(Decimals) {}
+
+    ///Appends any remaining text to the target.
+    ~NumberWriter()
+    {
+      Flush();
+    }
+
+    ///Appends the text in the buffer to the target.
+    void Flush()
+    {
+      if(Length)
+        Target.Append((const prim::byte*)Buffer, Length);
+      Length = 0;
+    }
+
+    ///Starts a new line if anything has been written to the target yet.
+    void Line()
+    {
+      if(Length || Target.n())
+        *this << '\n';
+    }
+
+    ///Writes a number.
+    NumberWriter& operator << (prim::number x)
+    {
+      Reserve(MaxNumberLength);
+      Length += Format(x, Decimals, &Buffer[Length]);
+      return *this;
+    }
+
+    ///Writes a character.
+    NumberWriter& operator << (prim::ascii c)
+    {
+      Reserve(1);
+      Buffer[Length++] = c;
+      return *this;
+    }
+
+    ///Writes a null-terminated string.
+    NumberWriter& operator << (const prim::ascii* s)
+    {
+      for(; *s; s++)
+        *this << *s;
+      return *this;
+    }
+
+    /**Formats a number with up to the given number of decimal places (at most
+    nine), and returns the number of characters written. The output must have
+    room for MaxNumberLength characters. Very large magnitudes are clamped.*/
+    static prim::count Format(prim::number x, prim::count Decimals,
+      prim::ascii* Output)
+    {
+      static const prim::uint64 Powers[10] = {1ULL, 10ULL, 100ULL, 1000ULL,
+        10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+        1000000000ULL};
+
+      if(Decimals < 0) Decimals = 0;
+      if(Decimals > 9) Decimals = 9;
+
+      //Write not-a-number as zero.
+      if(x != x) x = 0.0;
+
+      bool Negative = x < 0.0;
+      if(Negative) x = -x;
+
+      //Clamp the magnitude so that the scaled value fits in 64 bits.
+      prim::number Limit = 1.0e18 / (prim::number)Powers[Decimals];
+      if(x > Limit) x = Limit;
+
+      //Round to the requested number of decimal places.
+      prim::uint64 Scaled =
+        (prim::uint64)(x * (prim::number)Powers[Decimals] + 0.5);
+      prim::uint64 Whole = Scaled / Powers[Decimals];
+      prim::uint64 Fraction = Scaled % Powers[Decimals];
+
+      prim::ascii* p = Output;
+      if(Negative && Scaled)
+        *p++ = '-';
+
+      //Write the whole part.
+      prim::ascii Digits[20];
+      prim::count n = 0;
+      do
+      {
+        Digits[n++] = (prim::ascii)('0' + Whole % 10);
+        Whole /= 10;
+      } while(Whole);
+      while(n)
+        *p++ = Digits[--n];
+
+      //Write the fractional part without trailing zeroes.
+      if(Fraction)
+      {
+        prim::count Places = Decimals;
+        while(Fraction % 10 == 0)
+        {
+          Fraction /= 10;
+          Places--;
+        }
+
+        *p++ = '.';
+        for(prim::count i = Places - 1; i >= 0; i--)
+        {
+          p[i] = (prim::ascii)('0' + Fraction % 10);
+          Fraction /= 10;
+        }
+        p += Places;
+      }
+
+      return (prim::count)(p - Output);
+    }
+  };
+}}
+#endif
@@ -44,6 +44,7 @@
 #endif
 
 #include "../Abstracts.h"
+#include "NumberWriter.h"
 
 namespace bellebonnesage { namespace painters
 {
@@ -177,6 +178,30 @@ namespace bellebonnesage { namespace painters
       are involved due to the image space being constrained. It is recommended
       that this value remain at unit scale (keep at 1.0, the new default).*/
       prim::number CTMMultiplier;
+      
+      ///Number of decimal places written for numbers in content streams.
+      prim::count Precision;
+      
+      /**The flate compression level from 1 (fastest) to 9 (smallest). Use 0
+      to write the streams uncompressed.*/
+      prim::count CompressionLevel;
+      
+      /**The number of threads used to compress the streams. Threads are only
+      used if prim is compiled with PRIM_WITH_THREAD.*/
+      prim::count CompressionThreads;
+      
+      /**Whether to write each page to the file as soon as it is painted, so
+      that only one page is held in memory at a time. This requires a filename,
+      and Output is left empty.*/
+      bool Streaming;
+      
+      /**Whether a streamed page is compressed and written to the file on a
+      background thread while the next page is painted. Pages are still painted
+      one at a time and in order, since painting changes the shared forms,
+      images and transform stack. Only used when streaming and when prim is
+      compiled with PRIM_WITH_THREAD.*/
+      bool PipelinePages;
+      
       prim::String Filename;
       prim::String Output;
       prim::Array<prim::byte> ExtraData;
@@ -185,9 +210,11 @@ namespace bellebonnesage { namespace painters
       prim::String Title;
       prim::String Author;
       
-      Properties(prim::String Filename) : CTMMultiplier(1.0f),
-        Filename(Filename) {}
-      Properties() : CTMMultiplier(1.0f) {}
+      Properties(prim::String Filename) : CTMMultiplier(1.0f), Precision(5),
+        CompressionLevel(9), CompressionThreads(1), Streaming(false),
+        PipelinePages(false), Filename(Filename) {}
+      Properties() : CTMMultiplier(1.0f), Precision(5), CompressionLevel(9),
+        CompressionThreads(1), Streaming(false), PipelinePages(false) {}
     };
 
     public:
@@ -345,39 +372,10 @@ namespace bellebonnesage { namespace painters
     ///An internal representation of PDF objects
     struct Object
     {
-      /**Stores the information for an embedded cross-reference. Whenever
-      an object's stream cross-references another object, instead of
-      immediately committing the reference, the insertion point and object
-      pointer are saved so that after all the streams are committed, the
-      insertions are made and the references are committed. This allows
-      the objects to be instantiated and ordered arbitrarily.*/
-      struct XRef
-      {
-        ///Pointer to the object that this XRef references
-        Object* ObjectToReference;
-
-        ///The point of insertion in the string
-        prim::count InsertionPoint;
-
-        ///Default constructor zeroes the structure.
-        XRef() : ObjectToReference(0), InsertionPoint(0) {}
-
-        /**\brief This constructor allows the structure's data members
-        to be passed as arguments.*/
-        XRef(Object* ObjectToReference, prim::count InsertionPoint)
-        {
-          XRef::ObjectToReference = ObjectToReference;
-          XRef::InsertionPoint = InsertionPoint;
-        }
-      };
-
-      ///This object's cross-reference index
+      /**This object's cross-reference index. Objects are numbered in the order
+      they are created so that references to them can be written right away.*/
       prim::count XRefIndex;
 
-      /**\brief This object's cross-reference offset from the beginning of
-      the file*/
-      prim::count XRefOffset;
-
       /**\brief Indicates whether or not the content stream's double
       brackets should be automatically included.*/
       bool NoAutoBrackets;
@@ -387,133 +385,116 @@ namespace bellebonnesage { namespace painters
 
       ///The object's PDF content stream
       prim::String Content;
-
-      /**\brief A list of pending cross-references to be inserted into
-      dictionaries*/
-      prim::List<XRef> DictionaryXRefs;
-
-      /**\brief A list of pending cross-references to be inserted into
-      content streams*/
-      prim::List<XRef> ContentXRefs;
+      
+      ///The compressed content stream if compression was successful
+      prim::String CompressedContent;
 
       /**\brief Default constructor turns on auto-brackets and zeroes
       everything else.*/
-      Object() : XRefIndex(0), XRefOffset(0), NoAutoBrackets(false) {}
+      Object() : XRefIndex(0), NoAutoBrackets(false) {}
 
-      /**\brief Inserts an object cross-reference to be committed to the
-      current end of the dictionary string.*/
-      void InsertDictionaryXRef(Object* ObjectToReference)
+      ///Writes a reference to an object to the end of the dictionary string.
+      void InsertDictionaryXRef(const Object* ObjectToReference)
       {
-        XRef ObjectXRef(ObjectToReference, Dictionary.n());
-        DictionaryXRefs.Append(ObjectXRef);
+        InsertDictionaryXRef(ObjectToReference->XRefIndex);
       }
 
-      /**\brief Inserts an object cross-reference to be committed to the
-      current end of the content stream string.*/
-      void InsertContentXRef(Object* ObjectToReference)
+      ///Writes a reference to an object index to the end of the dictionary.
+      void InsertDictionaryXRef(prim::count IndexOfReferent)
       {
-        XRef ObjectXRef(ObjectToReference, Content.n());
-        ContentXRefs.Append(ObjectXRef);
+        Dictionary << (prim::integer)IndexOfReferent << " 0 R";
       }
 
-      ///Commits a list of cross-references to an object string.
-      void CommitXRefList(prim::List<XRef>& XRefList,
-        prim::String& ObjectString)
+      ///Writes a reference to an object to the end of the content stream.
+      void InsertContentXRef(const Object* ObjectToReference)
       {
-        using namespace prim;
-
-        /**\brief Commit the cross-references by going through the list
-        of XRefs and inserting the appropriate data into the string.
-        \details Each insertion adds a few characters to the string, so
-        this error must be corrected by keeping track of the insertion
-        widths in InsertionBias.*/
-        prim::count InsertionBias=0;
-        for(count i=0;i<XRefList.n();i++)
-        {
-          XRef& CurrentXRef = XRefList[i];
-
-          prim::count IndexOfReferent =
-            CurrentXRef.ObjectToReference->XRefIndex;
-          prim::count InsertionPointOfReferent =
-            CurrentXRef.InsertionPoint;
-          prim::count FinalInsertionPoint =
-            InsertionBias + InsertionPointOfReferent;
-
-          prim::String XRefString;
-          XRefString << (integer)IndexOfReferent;
-          XRefString << " 0 R";
-
-          ObjectString.Insert(XRefString, FinalInsertionPoint);
-
-          InsertionBias += XRefString.n();
-        }
+        Content << (prim::integer)ObjectToReference->XRefIndex << " 0 R";
       }
     };
 
     ///A list of the objects which compose the PDF file.
     prim::List<Object*> Objects;
+    
+    ///The number of objects created so far in the file.
+    prim::count ObjectCount;
+    
+    ///The byte offset of each written object indexed by its XRefIndex.
+    prim::Array<prim::count> XRefOffsets;
 
     /**A pointer to the currently active raster target. This object pointer
     is used by the drawing methods.*/
     Object* RasterObject;
     
-    ///The number of images used.
-    prim::List<Object*> ImageList;
+    ///The object indexes of the images used.
+    prim::List<prim::count> ImageList;
     prim::Array<Resource> ImageResourceList;
 
     ///Cached pointer to the current portfolio being painted.
     Portfolio* CachedPortfolio;
+    
+    /**Identifies a form XObject by the shared path it draws and the raster
+    state it was drawn with. The stroke width and paint operator are written
+    into the form, while the colors are inherited from the page.*/
+    struct FormKey
+    {
+      const Path* SharedPath;
+      prim::number StrokeWidth;
+      prim::count PaintOperator;
+      
+      FormKey() : SharedPath(0), StrokeWidth(0.0), PaintOperator(0) {}
+      
+      FormKey(const Path* SharedPath, prim::number StrokeWidth,
+        prim::count PaintOperator) : SharedPath(SharedPath),
+        StrokeWidth(StrokeWidth), PaintOperator(PaintOperator) {}
+      
+      bool operator < (const FormKey& o) const
+      {
+        if(SharedPath != o.SharedPath) return SharedPath < o.SharedPath;
+        if(StrokeWidth != o.StrokeWidth) return StrokeWidth < o.StrokeWidth;
+        return PaintOperator < o.PaintOperator;
+      }
+      
+      bool operator > (const FormKey& o) const {return o < *this;}
+      
+      bool operator == (const FormKey& o) const
+      {
+        return SharedPath == o.SharedPath && StrokeWidth == o.StrokeWidth &&
+          PaintOperator == o.PaintOperator;
+      }
+      
+      bool operator != (const FormKey& o) const {return !(*this == o);}
+    };
+    
+    ///The object indexes of the form XObjects created for shared paths.
+    prim::List<prim::count> FormList;
+    
+    ///Looks up the index of the form in FormList for a shared path.
+    prim::Table<FormKey, prim::count> FormIndex;
 
     public:
     
     ///Default constructor for the PDF painter
-    PDF() : RasterObject(0), CachedPortfolio(0) {}
+    PDF() : ObjectCount(0), RasterObject(0), CachedPortfolio(0),
+      FormIndex(-1) {}
 
     ///Properties of the PDF file
     PDF::Properties* PDFProperties;
 
     /**Internal method creates a new PDF object. PDF files are made of
-    objects which are marked off by 1 0 obj and endobj. By storing these
-    objects in a list, the actual indexing process can be deferred until the
-    conclusion of data writing, so that the file can be optimally organized
-    for debugging purposes.*/
+    objects which are marked off by 1 0 obj and endobj. Objects are numbered in
+    the order they are created, and are held in a list until they are written
+    out by CommitObjects or StreamObjects.*/
     Object* CreatePDFObject()
     {
       Object* NewPDFObject = new Object;
+      NewPDFObject->XRefIndex = ++ObjectCount;
       Objects.Append(NewPDFObject);
       return NewPDFObject;
     }
-
-    /**\brief Writes all of the objects to a single flat stream as a string
-    referenced in the parameter list.*/
-    void CommitObjects(prim::String& ByteStream)
+    
+    ///Writes the header of the PDF file.
+    void WriteHeader(prim::String& ByteStream)
     {
-      //Include the namespaces.
-      using namespace prim;
-
-      //Put the objects in the same order they were created.
-      for(prim::count i = 0; i < Objects.n(); i++)
-        Objects[i]->XRefIndex = i + 1;
-
-      //The first object in this case will be the root.
-      Object* RootObject=Objects.a();
-
-      //The info (metadata) object will be the second object.
-      Object* InfoObject=Objects[1];
-
-      //Commit the indexes to each of the objects.
-      for(prim::count i=0;i<Objects.n();i++)
-      {
-        //Commit the dictionary cross-references.
-        Objects[i]->CommitXRefList(
-          Objects[i]->DictionaryXRefs,Objects[i]->Dictionary);
-
-        //Commit the content cross-references.
-        Objects[i]->CommitXRefList(
-          Objects[i]->ContentXRefs,Objects[i]->Content);
-      }
-
-      //Write the header.
       ByteStream = "%PDF-1.3"; //Can be adjusted as necessary.
       ByteStream >> "%";
       ByteStream.Append((prim::unicode)0xE2); //a_Circumflex
@@ -521,27 +502,55 @@ namespace bellebonnesage { namespace painters
       ByteStream.Append((prim::unicode)0xCF); //I_Umlaut
       ByteStream.Append((prim::unicode)0xD3); //O_Acute
       ByteStream++;
-
-      //Write the objects.
-      for(prim::count XRefObject = 1; XRefObject < Objects.n() + 1;
-        XRefObject++)
+    }
+    
+    /**Moves the objects from the given index in the object list onwards into
+    an array and makes room for their cross-reference offsets.*/
+    void DetachObjects(prim::count FirstObject,
+      prim::Array<Object*>& ObjectArray)
+    {
+      ObjectArray.n(Objects.n() - FirstObject);
+      for(prim::count i = 0; i < ObjectArray.n(); i++)
+        ObjectArray[i] = Objects[FirstObject + i];
+      Objects.RemoveFrom(FirstObject);
+      
+      if(XRefOffsets.n() < ObjectCount + 1)
+        XRefOffsets.n(ObjectCount + 1);
+    }
+    
+    /**Writes the objects from the given index in the object list onwards and
+    then deletes them. The byte stream is appended to and is assumed to begin
+    at the given offset into the file, so that the object offsets can be
+    recorded for the cross-reference table.*/
+    void WriteObjects(prim::count FirstObject, prim::String& ByteStream,
+      prim::count StartOffset = 0)
+    {
+      prim::Array<Object*> ObjectArray;
+      DetachObjects(FirstObject, ObjectArray);
+      WriteObjects(ObjectArray, ByteStream, StartOffset);
+    }
+    
+    /**Writes detached objects and then deletes them. Only the objects'
+    entries in the cross-reference offsets are changed, so this may run on
+    another thread while new objects are created.*/
+    void WriteObjects(prim::Array<Object*>& ObjectArray,
+      prim::String& ByteStream, prim::count StartOffset)
+    {
+      using namespace prim;
+      
+      //Compress the content streams before the objects are written.
+      CompressObjects(ObjectArray);
+      
+      for(count i = 0; i < ObjectArray.n(); i++)
       {
-        //Find the Object by looking it up by XRef object number.
-        Object* CurrentObject = 0;
-        for(prim::count LookupIndex = 0; LookupIndex < Objects.n();
-          LookupIndex++)
-        {
-          CurrentObject = Objects[LookupIndex];
-          if(CurrentObject->XRefIndex == XRefObject)
-            break;
-        }
-
+        Object* CurrentObject = ObjectArray[i];
+        
         /*Save the XRef offset of this object to help with the object
         table of contents at the end of the file.*/
-        CurrentObject->XRefOffset = ByteStream.n();
+        XRefOffsets[CurrentObject->XRefIndex] = StartOffset + ByteStream.n();
 
         //Begin the object.
-        ByteStream << (integer)XRefObject;
+        ByteStream << (integer)CurrentObject->XRefIndex;
         ByteStream << " 0 obj";
         ByteStream++;
 
@@ -552,17 +561,11 @@ namespace bellebonnesage { namespace painters
           ByteStream++;
         }
         
-        //Determine whether compression should be attempted.
-        bool AttemptCompression = !CurrentObject->Dictionary.Contains("/Length")
-          && CurrentObject->Content.n() > 0;
-        
-        //Attempt to compress the stream.
-        String CompressedStream;
-        if(AttemptCompression)
-          AttemptFlate(CurrentObject->Content, CompressedStream);
+        //Determine whether compression was attempted.
+        bool AttemptCompression = ShouldCompress(*CurrentObject);
         
-        //To turn off compression for debugging enable this line:
-        //CompressedStream.Clear();
+        //Get the compressed stream if compression was successful.
+        String& CompressedStream = CurrentObject->CompressedContent;
 
         //If the stream was compressed then add the entries to the dictionary.
         if(CompressedStream)
@@ -600,31 +603,35 @@ namespace bellebonnesage { namespace painters
         ByteStream << "endobj";
         ByteStream++;
         ByteStream++;
+        
+        //Delete the object now that it is no longer necessary.
+        delete CurrentObject;
       }
-
+    }
+    
+    /**Writes the cross-reference table and trailer. The byte stream is assumed
+    to begin at the given offset into the file.*/
+    void WriteTrailer(prim::String& ByteStream, prim::count StartOffset = 0)
+    {
+      using namespace prim;
+      
+      //The first object is the root and the second is the info (metadata).
+      const count RootIndex = 1, InfoIndex = 2;
+      
       //Write the XRef table of contents found at the end of the PDF file.
-      prim::count XRefLocation = ByteStream.n();
+      prim::count XRefLocation = StartOffset + ByteStream.n();
       ByteStream << "xref";
       ByteStream >> "0 ";
-      ByteStream << (integer)(Objects.n() + 1);
+      ByteStream << (integer)(ObjectCount + 1);
       ByteStream >> "0000000000 65535 f";
       ByteStream.Append(13);
       ByteStream.Append(10);
 
       //Write each XRef entry.
-      for(count ObjectIndex = 1; ObjectIndex < Objects.n() + 1; ObjectIndex++)
+      for(count ObjectIndex = 1; ObjectIndex < ObjectCount + 1; ObjectIndex++)
       {
-        //Again find the current object by looking it up by XRef index.
-        Object* CurrentObject = 0;
-        for(count LookupIndex = 0; LookupIndex < Objects.n(); LookupIndex++)
-        {
-          CurrentObject = Objects[LookupIndex];
-          if(CurrentObject->XRefIndex == ObjectIndex)
-            break;
-        }
-
         //Was AppendInteger(CurrentObject->XRefOffset,10);
-        String Integer; Integer << CurrentObject->XRefOffset;
+        String Integer; Integer << XRefOffsets[ObjectIndex];
         String PaddedInteger;
         for(count i = 0; i < 10 - Integer.n(); i++)
           PaddedInteger << "0";
@@ -649,12 +656,12 @@ namespace bellebonnesage { namespace painters
       ByteStream << "trailer";
       ByteStream >> "<<";
       ByteStream >> "/Size ";
-      ByteStream << (integer)(Objects.n() + 1L);
+      ByteStream << (integer)(ObjectCount + 1L);
       ByteStream >> "/Root ";
-      ByteStream << (integer)RootObject->XRefIndex;
+      ByteStream << (integer)RootIndex;
       ByteStream << " 0 R";
       ByteStream >> "/Info ";
-      ByteStream << (integer)InfoObject->XRefIndex;
+      ByteStream << (integer)InfoIndex;
       ByteStream << " 0 R";      
       ByteStream >> "/ID[<" << FileIDString << ">";
       ByteStream << "<" << FileIDString << ">]";
@@ -662,15 +669,61 @@ namespace bellebonnesage { namespace painters
       ByteStream >> "startxref";
       ByteStream >> (integer)XRefLocation;
       ByteStream >> "%%EOF";
+    }
 
-      //Delete each object manually now that they are no longer necessary.
-      for(count i = 0; i < Objects.n(); i++)
-        delete Objects[i];
-
-      //Remove everything in the list.
-      Objects.RemoveAll();
+    /**\brief Writes all of the objects to a single flat stream as a string
+    referenced in the parameter list.*/
+    void CommitObjects(prim::String& ByteStream)
+    {
+      WriteHeader(ByteStream);
+      WriteObjects(0, ByteStream, 0);
+      WriteTrailer(ByteStream, 0);
+    }
+    
+    /**Writes the objects from the given index in the object list onwards to
+    the end of a file, updating the number of bytes written to the file.*/
+    void StreamObjects(prim::count FirstObject, const prim::String& Filename,
+      prim::count& BytesWritten)
+    {
+      prim::Array<Object*> ObjectArray;
+      DetachObjects(FirstObject, ObjectArray);
+      StreamObjects(ObjectArray, Filename, BytesWritten);
     }
     
+    ///Writes detached objects to the end of a file and then deletes them.
+    void StreamObjects(prim::Array<Object*>& ObjectArray,
+      const prim::String& Filename, prim::count& BytesWritten)
+    {
+      prim::String ByteStream;
+      WriteObjects(ObjectArray, ByteStream, BytesWritten);
+      prim::File::Append(Filename.Merge(), ByteStream);
+      BytesWritten += ByteStream.n();
+    }
+    
+#ifdef PRIM_WITH_THREAD
+    /**Thread which compresses and writes the objects of a finished page while
+    the next page is painted. Only one runs at a time, so pages reach the file
+    in order.*/
+    class PageWriter : public prim::Thread
+    {
+      public:
+      
+      PDF* Owner;
+      prim::Array<Object*> ObjectArray;
+      prim::String Filename;
+      prim::count* BytesWritten;
+      
+      PageWriter() : Owner(0), BytesWritten(0) {}
+      
+      virtual ~PageWriter() {}
+      
+      void Run()
+      {
+        Owner->StreamObjects(ObjectArray, Filename, *BytesWritten);
+      }
+    };
+#endif
+    
     ///Returns the current version of this painter.
     prim::String GetProducer()
     {
@@ -768,20 +821,36 @@ namespace bellebonnesage { namespace painters
       return s;
     }
     
-    //Attempts to compress the data using the flate algorithm.
-    static void AttemptFlate(const prim::String& In, prim::String& Out)
+    /**Attempts to compress the data using the flate algorithm. If zlib is
+    available (BELLEBONNESAGE_WITH_ZLIB) it is used directly, otherwise JUCE is
+    used if present. If neither is available or the level is zero, the output
+    is left empty to indicate the data was not compressed.*/
+    static void AttemptFlate(const prim::String& In, prim::String& Out,
+      prim::count Level = 9)
     {
       //Clear the output.
       Out.Clear();
       
       //If there is no data to compress then just return.
-      if(!In.n())
+      if(!In.n() || Level <= 0)
         return;
+      if(Level > 9)
+        Level = 9;
       
-#if defined(JUCE_VERSION)
+#if defined(BELLEBONNESAGE_WITH_ZLIB)
+      //Compress the whole stream in one call to zlib.
+      uLongf CompressedSize = compressBound((uLong)In.n());
+      prim::Array<prim::byte> CompressedOut;
+      CompressedOut.n((prim::count)CompressedSize);
+      if(compress2((Bytef*)&CompressedOut.a(), &CompressedSize,
+        (const Bytef*)In.Merge(), (uLong)In.n(), (int)Level) != Z_OK)
+          return;
+      Out.Append(&CompressedOut.a(), (prim::count)CompressedSize);
+#elif defined(JUCE_VERSION)
       //JUCE has a built-in GZIP compressor, so use that if it is available.
       juce::MemoryOutputStream CompressedOut;
-      juce::GZIPCompressorOutputStream Compressor(&CompressedOut, 9, false);
+      juce::GZIPCompressorOutputStream Compressor(&CompressedOut, (int)Level,
+        false);
       if(!Compressor.write(In.Merge(), In.n()))
         return;
       Compressor.flush();
@@ -794,6 +863,82 @@ namespace bellebonnesage { namespace painters
 #endif
     }
     
+    ///Returns whether the content stream of the object should be compressed.
+    static bool ShouldCompress(const Object& o)
+    {
+      return !o.Dictionary.Contains("/Length") && o.Content.n() > 0;
+    }
+    
+    ///Compresses the content stream of each object in a range.
+    static void CompressObjects(prim::Array<Object*>& ObjectArray,
+      prim::count First, prim::count Step, prim::count Level)
+    {
+      for(prim::count i = First; i < ObjectArray.n(); i += Step)
+      {
+        Object* o = ObjectArray[i];
+        o->CompressedContent.Clear();
+        if(ShouldCompress(*o))
+          AttemptFlate(o->Content, o->CompressedContent, Level);
+      }
+    }
+    
+#ifdef PRIM_WITH_THREAD
+    ///Thread which compresses every nth object of an array.
+    class CompressionThread : public prim::Thread
+    {
+      public:
+      
+      prim::Array<Object*>* ObjectArray;
+      prim::count First;
+      prim::count Step;
+      prim::count Level;
+      
+      CompressionThread() : ObjectArray(0), First(0), Step(1), Level(9) {}
+      
+      virtual ~CompressionThread() {}
+      
+      void Run()
+      {
+        CompressObjects(*ObjectArray, First, Step, Level);
+      }
+    };
+#endif
+    
+    /**Compresses the content streams of the objects using the compression
+    level and number of threads given in the properties.*/
+    void CompressObjects(prim::Array<Object*>& ObjectArray)
+    {
+      prim::count Level = PDFProperties->CompressionLevel;
+      prim::count Threads = PDFProperties->CompressionThreads;
+      if(Threads > ObjectArray.n())
+        Threads = ObjectArray.n();
+      
+#ifdef PRIM_WITH_THREAD
+      if(Threads > 1)
+      {
+        //Compress every nth object on each thread.
+        prim::Array<CompressionThread*> Workers;
+        Workers.n(Threads);
+        for(prim::count i = 0; i < Threads; i++)
+        {
+          Workers[i] = new CompressionThread;
+          Workers[i]->ObjectArray = &ObjectArray;
+          Workers[i]->First = i;
+          Workers[i]->Step = Threads;
+          Workers[i]->Level = Level;
+          Workers[i]->Begin();
+        }
+        for(prim::count i = 0; i < Threads; i++)
+        {
+          Workers[i]->WaitToEnd();
+          delete Workers[i];
+        }
+        return;
+      }
+#endif
+      CompressObjects(ObjectArray, 0, 1, Level);
+    }
+    
     virtual void Paint(Portfolio* PortfolioToPaint,
       Painter::Properties* PortfolioProperties)
     {
@@ -815,6 +960,29 @@ namespace bellebonnesage { namespace painters
 
       //Save for later reference by other methods.
       PDFProperties = p;
+      
+      //Objects, images and forms are only valid for the file being written.
+      Objects.RemoveAndDeleteAll();
+      ObjectCount = 0;
+      XRefOffsets.n(0);
+      ImageList.RemoveAll();
+      ImageResourceList.n(0);
+      FormList.RemoveAll();
+      FormIndex.Clear();
+      
+      //If streaming, then write the header to the file now.
+      bool Streaming = p->Streaming && p->Filename != "";
+      prim::count BytesWritten = 0;
+#ifdef PRIM_WITH_THREAD
+      PageWriter* Writer = 0;
+#endif
+      if(Streaming)
+      {
+        String Header;
+        WriteHeader(Header);
+        File::Write(p->Filename.Merge(), Header);
+        BytesWritten = Header.n();
+      }
 
       //Create the main object entries in the PDF.
       Object* Catalog = CreatePDFObject(); //must be 1 0 R
@@ -867,16 +1035,17 @@ namespace bellebonnesage { namespace painters
       //Grab the canvas list from the portfolio.
       List<Canvas*>& cl  = PortfolioToPaint->Canvases;
 
-      //An internal list of page content objects.
-      List<Object*> PageObjects;
+      //An internal list of the indexes of the page objects.
+      List<count> PageObjects;
 
       //Loop through each canvas and commit it to a PDF page.
       for(count i = 0; i < cl.n(); i++)
       {
         //Create objects for page header and content information.
+        count FirstPageObject = Objects.n();
         Object* PageHeader = CreatePDFObject();
         Object* PageContent = RasterObject = CreatePDFObject();
-        PageObjects.Append(PageHeader);
+        PageObjects.Append(PageHeader->XRefIndex);
 
         Points Size = cl[i]->Dimensions;
         
@@ -971,7 +1140,40 @@ namespace bellebonnesage { namespace painters
 
         //Set the current drawing target to null to be safe.
         RasterObject = 0;
+        
+        //Write out the objects created for the page if streaming.
+        if(Streaming)
+        {
+#ifdef PRIM_WITH_THREAD
+          if(p->PipelinePages)
+          {
+            //Wait for the previous page and then write this one behind.
+            if(Writer)
+            {
+              Writer->WaitToEnd();
+              delete Writer;
+            }
+            Writer = new PageWriter;
+            Writer->Owner = this;
+            DetachObjects(FirstPageObject, Writer->ObjectArray);
+            Writer->Filename = p->Filename;
+            Writer->BytesWritten = &BytesWritten;
+            Writer->Begin();
+            continue;
+          }
+#endif
+          StreamObjects(FirstPageObject, p->Filename, BytesWritten);
+        }
       }
+      
+#ifdef PRIM_WITH_THREAD
+      //Finish writing the last page before the remaining objects.
+      if(Writer)
+      {
+        Writer->WaitToEnd();
+        delete Writer;
+      }
+#endif
 
       //Write the table of contents for the pages.
       Pages->Dictionary >> "/Type /Pages";
@@ -997,6 +1199,15 @@ namespace bellebonnesage { namespace painters
         ImageCatalog->Dictionary << " ";
         ImageCatalog->InsertDictionaryXRef(ImageList[i]);
       }
+      
+      //Add the forms of the shared paths to the same catalog.
+      for(prim::count i = 0; i < FormList.n(); i++)
+      {
+        ImageCatalog->Dictionary >> "/Fm";
+        ImageCatalog->Dictionary << (integer)i;
+        ImageCatalog->Dictionary << " ";
+        ImageCatalog->InsertDictionaryXRef(FormList[i]);
+      }
 
       //Create the info object.
       Info->Dictionary >> "/Title (" << LiteralEscape(p->Title) << ")";
@@ -1038,12 +1249,24 @@ namespace bellebonnesage { namespace painters
         ExtraData->Dictionary >> "/Subtype /XML";
       }
       
-      //Commit all of the objects to the output string.
-      CommitObjects(p->Output);
+      if(Streaming)
+      {
+        //Write the remaining objects and the trailer to the file.
+        StreamObjects(0, p->Filename, BytesWritten);
+        String Trailer;
+        WriteTrailer(Trailer, BytesWritten);
+        File::Append(p->Filename.Merge(), Trailer);
+        p->Output.Clear();
+      }
+      else
+      {
+        //Commit all of the objects to the output string.
+        CommitObjects(p->Output);
 
-      //If applicable send the output to file.
-      if(p->Filename != "")
-        File::Write(p->Filename.Merge(), p->Output);
+        //If applicable send the output to file.
+        if(p->Filename != "")
+          File::Write(p->Filename.Merge(), p->Output);
+      }
       
       //Clear the cached portfolio.
       CachedPortfolio = 0;
@@ -1073,8 +1296,13 @@ namespace bellebonnesage { namespace painters
       //Create the transform code.
       prim::number CTMMultiplier = PDFProperties->CTMMultiplier;
       prim::String t;
-      t >> "q" >> a.a << " " << a.b << " " << a.c << " " << a.d << " " <<
-        (a.e * CTMMultiplier) << " " << (a.f * CTMMultiplier) << " cm";
+      {
+        NumberWriter w(t, PDFProperties->Precision);
+        w << "q";
+        w.Line();
+        w << a.a << ' ' << a.b << ' ' << a.c << ' ' << a.d << ' ' <<
+          (a.e * CTMMultiplier) << ' ' << (a.f * CTMMultiplier) << " cm";
+      }
       
       //Write it to the PDF.
       Rasterize(t);
@@ -1102,16 +1330,16 @@ namespace bellebonnesage { namespace painters
       State = NewState;
       
       prim::String t;
-      
-      t >> NewState.StrokeColor.R;
-      t << " " << NewState.StrokeColor.G;
-      t << " " << NewState.StrokeColor.B;
-      t << " " << "SC";
-      
-      t >> NewState.FillColor.R;
-      t << " " << NewState.FillColor.G;
-      t << " " << NewState.FillColor.B;
-      t << " " << "sc";
+      {
+        NumberWriter w(t, PDFProperties->Precision);
+        w << (prim::number)NewState.StrokeColor.R << ' ' <<
+          (prim::number)NewState.StrokeColor.G << ' ' <<
+          (prim::number)NewState.StrokeColor.B << " SC";
+        w.Line();
+        w << (prim::number)NewState.FillColor.R << ' ' <<
+          (prim::number)NewState.FillColor.G << ' ' <<
+          (prim::number)NewState.FillColor.B << " sc";
+      }
       
       Rasterize(t);
     }
@@ -1120,16 +1348,32 @@ namespace bellebonnesage { namespace painters
     //Paths//
     //-----//
     
-    virtual void Draw(const Path& p, const Affine& a)
+    ///Returns the index of the path painting operator for the raster state.
+    prim::count GetPaintOperator()
+    {
+      if(State.StrokeWidth > 0.f && State.StrokeColor.A > 0.f &&
+        State.FillColor.A == 0.f)
+          return 0; //Stroke only.
+      else if((State.StrokeWidth == 0.f || State.StrokeColor.A == 0.f) && 
+        State.FillColor.A >= 0.f)
+          return 1; //Fill only.
+      else if(State.StrokeWidth > 0.f && State.StrokeColor.A > 0.f &&
+        State.FillColor.A >= 0.f)
+          return 2; //Fill and stroke.
+      return 3; //"No-op"
+    }
+    
+    ///Writes the path and its painting operator for the raster state.
+    void AppendPath(prim::String& t, const Path& p)
     {
       using namespace prim;
-      String t;
       number CTMMultiplier = PDFProperties->CTMMultiplier;
+      NumberWriter w(t, PDFProperties->Precision);
 
       if(State.StrokeWidth != 0.f)
       {
-        t >> Abs(State.StrokeWidth) * CTMMultiplier;
-        t << " " << "w";
+        w.Line();
+        w << Abs(State.StrokeWidth) * CTMMultiplier << " w";
       }
       
       for(count j = 0; j < p.n(); j++)
@@ -1138,43 +1382,41 @@ namespace bellebonnesage { namespace painters
         
         if(i.IsMove())
         {
-          t >> i.End().x * CTMMultiplier;
-          t << " " << i.End().y * CTMMultiplier;
-          t << " " << "m";
+          w.Line();
+          w << i.End().x * CTMMultiplier << ' ' <<
+            i.End().y * CTMMultiplier << " m";
         }
         else if(i.IsLine())
         {
-          t >> i.End().x * CTMMultiplier;
-          t << " " << i.End().y * CTMMultiplier;
-          t << " " << "l";
+          w.Line();
+          w << i.End().x * CTMMultiplier << ' ' <<
+            i.End().y * CTMMultiplier << " l";
         }
         else if(i.IsCubic())
         {
-          t >> i.Control1().x * CTMMultiplier;
-          t << " " << i.Control1().y * CTMMultiplier;
-          t << " " << i.Control2().x * CTMMultiplier;
-          t << " " << i.Control2().y * CTMMultiplier;
-          t << " " << i.End().x * CTMMultiplier;
-          t << " " << i.End().y * CTMMultiplier;
-          t << " " << "c";
+          w.Line();
+          w << i.Control1().x * CTMMultiplier << ' ' <<
+            i.Control1().y * CTMMultiplier << ' ' <<
+            i.Control2().x * CTMMultiplier << ' ' <<
+            i.Control2().y * CTMMultiplier << ' ' <<
+            i.End().x * CTMMultiplier << ' ' <<
+            i.End().y * CTMMultiplier << " c";
         }
         else if(i.IsClosing())
         {
-          t << " " << "h";
+          w << " h";
         }
       }
 
-      if(State.StrokeWidth > 0.f && State.StrokeColor.A > 0.f &&
-        State.FillColor.A == 0.f)
-          t >> "S"; //Stroke only.
-      else if((State.StrokeWidth == 0.f || State.StrokeColor.A == 0.f) && 
-        State.FillColor.A >= 0.f)
-          t >> "f"; //Fill only.
-      else if(State.StrokeWidth > 0.f && State.StrokeColor.A > 0.f &&
-        State.FillColor.A >= 0.f)
-          t >> "B"; //Fill and stroke.
-      else
-        t >> "n"; //"No-op"
+      const ascii* PaintOperators[4] = {"S", "f", "B", "n"};
+      w.Line();
+      w << PaintOperators[GetPaintOperator()];
+    }
+    
+    virtual void Draw(const Path& p, const Affine& a)
+    {
+      prim::String t;
+      AppendPath(t, p);
       
       //Collapse the temporary operator string.
       t.Merge();
@@ -1184,6 +1426,49 @@ namespace bellebonnesage { namespace painters
       Revert(1);
     }
     
+    /**Draws a shared path by writing it once to a form XObject and then
+    invoking the form each time the path is drawn.*/
+    virtual void DrawShared(const Path& p, const Affine& a)
+    {
+      using namespace prim;
+      
+      //Paths without bounds can not be given a bounding box for the form.
+      planar::Rectangle r = p.Bounds();
+      if(!RasterObject || r.IsEmpty())
+      {
+        Draw(p, a);
+        return;
+      }
+      
+      //Look for a form already made for the path in this raster state.
+      count& Index = FormIndex[FormKey(&p, State.StrokeWidth,
+        GetPaintOperator())];
+      if(Index < 0)
+      {
+        Object* Form = CreatePDFObject();
+        FormList.Add() = Form->XRefIndex;
+        Index = FormList.n() - 1;
+        
+        //Expand the bounding box to include the stroke.
+        number CTMMultiplier = PDFProperties->CTMMultiplier;
+        number Margin = Abs(State.StrokeWidth);
+        Form->Dictionary >> "/Type /XObject";
+        Form->Dictionary >> "/Subtype /Form";
+        Form->Dictionary >> "/BBox [" <<
+          (r.Left() - Margin) * CTMMultiplier << " " <<
+          (r.Bottom() - Margin) * CTMMultiplier << " " <<
+          (r.Right() + Margin) * CTMMultiplier << " " <<
+          (r.Top() + Margin) * CTMMultiplier << "]";
+        AppendPath(Form->Content, p);
+      }
+      
+      String t;
+      t << "/Fm" << (integer)Index << " Do";
+      Transform(a);
+      Rasterize(t);
+      Revert(1);
+    }
+    
     virtual void Draw(const Resource& ResourceID, prim::planar::Vector Size)
     {
       //Need access to the portfolio to get access to the resources.
@@ -1224,7 +1509,8 @@ namespace bellebonnesage { namespace painters
       if(ImageResourceIndex == -1)
       {
         //Create an image object (an XObject in the PDF file).
-        ImageList.Add() = CreatePDFObject();
+        Object* ImageObject = CreatePDFObject();
+        ImageList.Add() = ImageObject->XRefIndex;
         ImageResourceList.Add() = *ImageResource;
         
         //Enter in the appropriate dictionary information.
@@ -1237,13 +1523,13 @@ namespace bellebonnesage { namespace painters
         Dictionary >> "   /BitsPerComponent 8"; //Always 8 for JPEGs.
         Dictionary >> "   /Length " << ImageString.n();
         Dictionary >> "   /Filter /DCTDecode";
-        ImageList.z()->Dictionary = Dictionary;
+        ImageObject->Dictionary = Dictionary;
         
         /*Load the data into the stream, filtered by hex to make things easier.
         Note that because of the hex filter, PDF has placed a restriction that
         the JPEG can not be of the progressive format. For now we will just 
         assume that the JPEG is not in this format.*/
-        ImageList.z()->Content = ImageString;
+        ImageObject->Content = ImageString;
         
         //Get the index of the image that was added.
         ImageResourceIndex = ImageResourceList.n() - 1;
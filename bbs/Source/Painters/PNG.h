@@ -0,0 +1,829 @@
+/*
+  ==============================================================================
+
+  Copyright 2007-2013 William Andrew Burnson. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+     1. Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimer.
+
+     2. Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY WILLIAM ANDREW BURNSON ''AS IS'' AND ANY EXPRESS
+  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+  EVENT SHALL WILLIAM ANDREW BURNSON OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+  INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+  OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  The views and conclusions contained in the software and documentation are
+  those of the authors and should not be interpreted as representing official
+  policies, either expressed or implied, of William Andrew Burnson.
+
+  ------------------------------------------------------------------------------
+
+  This file is part of Belle, Bonne, Sage --
+    The 'Beautiful, Good, Wise' C++ Vector-Graphics Library for Music Notation 
+
+  ==============================================================================
+*/
+
+#ifndef BELLEBONNESAGE_PAINTERS_PNG_H
+#define BELLEBONNESAGE_PAINTERS_PNG_H
+
+#ifdef BELLEBONNESAGE_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BELLEBONNESAGE_PNG_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "../Abstracts.h"
+
+namespace bellebonnesage { namespace painters
+{
+  /**Software rasterizer which paints each canvas to an RGBA pixel buffer and
+  encodes it as a PNG. It does not depend on JUCE, so it can be used to make
+  thumbnails and previews on machines without a display. Paths are flattened
+  to lines and scan-converted with exact area coverage for anti-aliasing. The
+  streams are compressed with zlib if BELLEBONNESAGE_WITH_ZLIB is defined and
+  stored uncompressed otherwise. Images are not drawn.*/
+  class PNG : public Painter
+  {
+    public:
+    
+    struct Properties : public Painter::Properties
+    {
+      ///Represents an array of output PNG files.
+      prim::List<prim::String> Output;
+      
+      /**Stem of filename(s) to write out to. If there is more than one page,
+      then the number of the page will be appended and .png. If there is just
+      one page, then only .png will be appended.*/
+      prim::String FilenameStem;
+      
+      ///Resolution of the image in pixels per inch.
+      prim::number PixelsPerInch;
+      
+      ///Color that each page is cleared to before painting.
+      Color Background;
+      
+      ///Compression level from 1 to 9 when zlib is available.
+      prim::count CompressionLevel;
+      
+      public:
+      
+      Properties() : PixelsPerInch(72.0), Background(Colors::white),
+        CompressionLevel(6) {}
+
+      friend class PNG;
+    };
+    
+    private:
+    
+    ///A line segment in pixel coordinates.
+    struct Segment
+    {
+      prim::planar::Vector a, b;
+      Segment() {}
+      Segment(prim::planar::Vector a, prim::planar::Vector b) : a(a), b(b) {}
+    };
+    
+    ///Contains PNG-specific pointers.
+    Properties* PNGProperties;
+    
+    ///Saves the portfolio pointer during painting so draw calls can access it.
+    Portfolio* CachedPortfolio;
+    
+    ///Dimensions of the current page in pixels.
+    prim::count Width, Height;
+    
+    ///Dimensions of the current page in inches.
+    Inches CurrentSize;
+    
+    ///Pixels of the current page stored as RGBA bytes.
+    prim::Array<prim::byte> Pixels;
+    
+    /**Signed area accumulation buffer for the path being filled. It is always
+    left cleared to zero after a fill.*/
+    prim::Array<prim::float32> Accumulation;
+    
+    ///Coverage of one row of the path being filled.
+    prim::Array<prim::float32> Coverage;
+    
+    ///Line segments of the path being filled.
+    prim::Array<Segment> Segments;
+    
+    ///Scratch array holding the flattened points of one subpath.
+    prim::Array<prim::planar::Vector> Points;
+    
+    ///Tolerance of curve flattening in pixels.
+    static prim::number FlatteningTolerance() {return 0.2;}
+    
+    ///Fast floor of a float.
+    static inline prim::int32 FloorInt(prim::float32 x)
+    {
+      prim::int32 i = (prim::int32)x;
+      return i - (x < (prim::float32)i ? 1 : 0);
+    }
+    
+    ///Fast ceiling of a float.
+    static inline prim::int32 CeilingInt(prim::float32 x)
+    {
+      prim::int32 i = (prim::int32)x;
+      return i + (x > (prim::float32)i ? 1 : 0);
+    }
+    
+    ///Returns the affine transform from the current space to pixels.
+    Affine PixelSpace()
+    {
+      prim::number ppi = PNGProperties->PixelsPerInch;
+      Affine B = Affine::Scale(prim::planar::Vector(ppi, -ppi)) *
+        Affine::Translate(prim::planar::Vector(0, -CurrentSize.y));
+      return B * CurrentSpace();
+    }
+    
+    //------------//
+    //Path Helpers//
+    //------------//
+    
+    /**Flattens a path transformed to pixels into polylines. Each subpath is
+    passed to the given method as an array of points, along with whether it
+    was explicitly closed.*/
+    template <class Callback>
+    void Flatten(const Path& p, const Affine& A, Callback& c)
+    {
+      Points.Clear();
+      bool Closed = false;
+      prim::planar::Vector Last;
+      for(prim::count j = 0; j < p.n(); j++)
+      {
+        const Instruction& i = p[j];
+        if(i.IsMove())
+        {
+          if(Points.n())
+            c(Points, Closed);
+          Points.Clear();
+          Closed = false;
+          Last = A << i.End();
+          Points.Add() = Last;
+        }
+        else if(i.IsLine())
+        {
+          Last = A << i.End();
+          Points.Add() = Last;
+        }
+        else if(i.IsCubic())
+        {
+          prim::planar::Vector p1 = A << i.Control1(), p2 = A << i.Control2(),
+            p3 = A << i.End();
+          
+          //Choose the number of lines from the curvature of the control net.
+          prim::number dd = prim::Max((Last - p1 * 2.0 + p2).Mag(),
+            (p1 - p2 * 2.0 + p3).Mag());
+          prim::count n = (prim::count)prim::Ceiling(
+            prim::Sqrt(0.75 * dd / FlatteningTolerance()));
+          n = prim::Min(prim::Max(n, (prim::count)1), (prim::count)100);
+          
+          for(prim::count k = 1; k <= n; k++)
+          {
+            prim::number t = (prim::number)k / (prim::number)n, u = 1.0 - t;
+            Points.Add() = Last * (u * u * u) + p1 * (3.0 * u * u * t) +
+              p2 * (3.0 * u * t * t) + p3 * (t * t * t);
+          }
+          Last = p3;
+        }
+        else
+          Closed = true;
+      }
+      if(Points.n())
+        c(Points, Closed);
+    }
+    
+    ///Adds the segments of a subpath to be filled, closing it implicitly.
+    struct FillOutline
+    {
+      prim::Array<Segment>& Segments;
+      FillOutline(prim::Array<Segment>& Segments) : Segments(Segments) {}
+      void operator () (const prim::Array<prim::planar::Vector>& p, bool)
+      {
+        for(prim::count i = 0; i < p.n(); i++)
+          Segments.Add() = Segment(p[i], p[(i + 1) % p.n()]);
+      }
+    };
+    
+    /**Adds polygons covering the stroke of a subpath. Each line becomes a
+    quadrilateral and each vertex an octagon for the joins. All polygons wind
+    the same way so that overlaps simply saturate.*/
+    struct StrokeOutline
+    {
+      prim::Array<Segment>& Segments;
+      prim::number HalfWidth;
+      StrokeOutline(prim::Array<Segment>& Segments, prim::number HalfWidth) :
+        Segments(Segments), HalfWidth(HalfWidth) {}
+      
+      void AddPolygon(const prim::planar::Vector* v, prim::count n)
+      {
+        //Keep every polygon wound in the same direction.
+        prim::number Area = 0.0;
+        for(prim::count i = 0; i < n; i++)
+          Area += v[i].x * v[(i + 1) % n].y - v[(i + 1) % n].x * v[i].y;
+        for(prim::count i = 0; i < n; i++)
+        {
+          if(Area >= 0.0)
+            Segments.Add() = Segment(v[i], v[(i + 1) % n]);
+          else
+            Segments.Add() = Segment(v[(i + 1) % n], v[i]);
+        }
+      }
+      
+      void AddJoin(prim::planar::Vector c)
+      {
+        prim::planar::Vector v[8];
+        for(prim::count i = 0; i < 8; i++)
+        {
+          v[i].Polar((prim::number)i * prim::Pi / 4.0, HalfWidth);
+          v[i] += c;
+        }
+        AddPolygon(v, 8);
+      }
+      
+      void operator () (const prim::Array<prim::planar::Vector>& p,
+        bool Closed)
+      {
+        prim::count Lines = Closed ? p.n() : p.n() - 1;
+        for(prim::count i = 0; i < Lines; i++)
+        {
+          prim::planar::Vector a = p[i], b = p[(i + 1) % p.n()];
+          prim::planar::Vector d = b - a;
+          if(d.Mag() <= 0.0)
+            continue;
+          prim::planar::Vector n =
+            prim::planar::Vector(-d.y, d.x) * (HalfWidth / d.Mag());
+          prim::planar::Vector v[4] = {a + n, b + n, b - n, a - n};
+          AddPolygon(v, 4);
+        }
+        for(prim::count i = Closed ? 0 : 1; i < p.n() - 1; i++)
+          AddJoin(p[i]);
+        if(Closed && p.n() > 1)
+          AddJoin(p.z());
+      }
+    };
+    
+    //-----------//
+    //Rasterizing//
+    //-----------//
+    
+    /**Accumulates the signed area of a line into a region of the accumulation
+    buffer. The line must lie within 0 <= x <= w. Each row has Stride floats
+    so that a line may touch the two columns after the last pixel.*/
+    void AccumulateLine(prim::float32 x0, prim::float32 y0, prim::float32 x1,
+      prim::float32 y1, prim::count Rows, prim::count Stride)
+    {
+      if(y0 == y1)
+        return;
+      
+      //Always go from top to bottom, remembering the direction.
+      prim::float32 Direction = 1.f;
+      if(y0 > y1)
+      {
+        prim::float32 t;
+        t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+        Direction = -1.f;
+      }
+      
+      /*Each row's x is found from the start of the line and kept within the
+      line's horizontal extent, so that rounding can never drift outside the
+      row.*/
+      prim::float32 dxdy = (x1 - x0) / (y1 - y0);
+      prim::float32 xMin = prim::Min(x0, x1), xMax = prim::Max(x0, x1);
+      prim::int32 yStart = prim::Max((prim::int32)0, FloorInt(y0));
+      prim::int32 yEnd = prim::Min((prim::int32)Rows, CeilingInt(y1));
+      prim::float32 x = prim::Clip(x0 + dxdy * (prim::Max(
+        (prim::float32)yStart, y0) - y0), xMin, xMax);
+      
+      prim::float32* a = &Accumulation.a();
+      for(prim::int32 y = yStart; y < yEnd; y++)
+      {
+        prim::float32* Row = &a[y * Stride];
+        prim::float32 yNext = prim::Min((prim::float32)(y + 1), y1);
+        prim::float32 dy = yNext - prim::Max((prim::float32)y, y0);
+        prim::float32 xNext = prim::Clip(x0 + dxdy * (yNext - y0), xMin, xMax);
+        prim::float32 d = dy * Direction;
+        prim::float32 xLeft = x < xNext ? x : xNext;
+        prim::float32 xRight = x < xNext ? xNext : x;
+        prim::int32 x0i = FloorInt(xLeft), x1i = CeilingInt(xRight);
+        prim::float32 x0Floor = (prim::float32)x0i;
+        
+        if(x1i <= x0i + 1)
+        {
+          //The line stays within one pixel in this row.
+          prim::float32 xMid = 0.5f * (x + xNext) - x0Floor;
+          Row[x0i] += d - d * xMid;
+          Row[x0i + 1] += d * xMid;
+        }
+        else
+        {
+          //Distribute the area of the line across the pixels it crosses.
+          prim::float32 s = 1.f / (xRight - xLeft);
+          prim::float32 x0f = xLeft - x0Floor;
+          prim::float32 a0 = 0.5f * s * (1.f - x0f) * (1.f - x0f);
+          prim::float32 x1f = xRight - (prim::float32)x1i + 1.f;
+          prim::float32 am = 0.5f * s * x1f * x1f;
+          Row[x0i] += d * a0;
+          if(x1i == x0i + 2)
+            Row[x0i + 1] += d * (1.f - a0 - am);
+          else
+          {
+            prim::float32 a1 = s * (1.5f - x0f);
+            Row[x0i + 1] += d * (a1 - a0);
+            for(prim::int32 xi = x0i + 2; xi < x1i - 1; xi++)
+              Row[xi] += d * s;
+            prim::float32 a2 = a1 + (prim::float32)(x1i - x0i - 3) * s;
+            Row[x1i - 1] += d * (1.f - a2 - am);
+          }
+          Row[x1i] += d * am;
+        }
+        x = xNext;
+      }
+    }
+    
+    /**Accumulates a line after clipping it horizontally to 0 <= x <= w. The
+    parts to either side are moved onto the edge, which keeps the coverage of
+    the pixels inside exact.*/
+    void AccumulateClippedLine(prim::planar::Vector a, prim::planar::Vector b,
+      prim::number w, prim::count Rows, prim::count Stride)
+    {
+      //Find where the line crosses each edge.
+      prim::number t[4] = {0.0, 0.0, 0.0, 1.0};
+      prim::count n = 1;
+      if(a.x != b.x)
+      {
+        prim::number tLeft = (0.0 - a.x) / (b.x - a.x);
+        prim::number tRight = (w - a.x) / (b.x - a.x);
+        if(tLeft > tRight)
+        {
+          prim::number Swap = tLeft; tLeft = tRight; tRight = Swap;
+        }
+        if(tLeft > 0.0 && tLeft < 1.0) t[n++] = tLeft;
+        if(tRight > 0.0 && tRight < 1.0) t[n++] = tRight;
+      }
+      t[n++] = 1.0;
+      
+      for(prim::count i = 0; i + 1 < n; i++)
+      {
+        prim::planar::Vector p = a + (b - a) * t[i];
+        prim::planar::Vector q = a + (b - a) * t[i + 1];
+        p.x = prim::Min(prim::Max(p.x, 0.0), w);
+        q.x = prim::Min(prim::Max(q.x, 0.0), w);
+        AccumulateLine((prim::float32)p.x, (prim::float32)p.y,
+          (prim::float32)q.x, (prim::float32)q.y, Rows, Stride);
+      }
+    }
+    
+    /**Turns one row of the accumulation buffer into coverage by summing it,
+    and clears the row for the next fill.*/
+    void SumRow(prim::float32* Row, prim::float32* Out, prim::count n)
+    {
+#ifdef BELLEBONNESAGE_PNG_SSE2
+      //Prefix sum of four floats at a time. The row is padded to a multiple of 4.
+      __m128 Offset = _mm_setzero_ps();
+      const __m128 SignMask = _mm_set1_ps(-0.f);
+      const __m128 One = _mm_set1_ps(1.f);
+      for(prim::count i = 0; i < n; i += 4)
+      {
+        __m128 x = _mm_loadu_ps(&Row[i]);
+        x = _mm_add_ps(x, _mm_castsi128_ps(
+          _mm_slli_si128(_mm_castps_si128(x), 4)));
+        x = _mm_add_ps(x, _mm_castsi128_ps(
+          _mm_slli_si128(_mm_castps_si128(x), 8)));
+        x = _mm_add_ps(x, Offset);
+        _mm_storeu_ps(&Out[i], _mm_min_ps(_mm_andnot_ps(SignMask, x), One));
+        _mm_storeu_ps(&Row[i], _mm_setzero_ps());
+        Offset = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));
+      }
+#else
+      prim::float32 Sum = 0.f;
+      for(prim::count i = 0; i < n; i++)
+      {
+        Sum += Row[i];
+        Row[i] = 0.f;
+        prim::float32 c = Sum < 0.f ? -Sum : Sum;
+        Out[i] = c < 1.f ? c : 1.f;
+      }
+#endif
+    }
+    
+    ///Fills a span of pixels with a solid color.
+    static void FillSpan(prim::uint32* p, prim::count n, prim::uint32 Value)
+    {
+      prim::count i = 0;
+#ifdef BELLEBONNESAGE_PNG_SSE2
+      __m128i v = _mm_set1_epi32((int)Value);
+      for(; i + 4 <= n; i += 4)
+        _mm_storeu_si128((__m128i*)&p[i], v);
+#endif
+      for(; i < n; i++)
+        p[i] = Value;
+    }
+    
+    ///Fills the segments with a color using the non-zero winding rule.
+    void Fill(const Color& c)
+    {
+      if(!Segments.n())
+        return;
+      
+      //Find the pixel bounds of the segments clipped to the page.
+      prim::planar::Rectangle r(Segments.a().a);
+      for(prim::count i = 0; i < Segments.n(); i++)
+        r += Segments[i].a, r += Segments[i].b;
+      prim::count Left = prim::Max((prim::count)FloorInt(
+        (prim::float32)r.Left()), (prim::count)0);
+      prim::count Right = prim::Min((prim::count)CeilingInt(
+        (prim::float32)r.Right()), Width);
+      prim::count Top = prim::Max((prim::count)FloorInt(
+        (prim::float32)r.Bottom()), (prim::count)0);
+      prim::count Bottom = prim::Min((prim::count)CeilingInt(
+        (prim::float32)r.Top()), Height);
+      if(Left >= Right || Top >= Bottom)
+        return;
+      
+      //Make room in the accumulation buffer for the region.
+      prim::count w = Right - Left, Rows = Bottom - Top;
+      prim::count Stride = (w + 2 + 3) & ~(prim::count)3;
+      if(Accumulation.n() < Stride * Rows)
+      {
+        Accumulation.n(Stride * Rows);
+        prim::Memory::Clear(&Accumulation.a(), Accumulation.n());
+      }
+      if(Coverage.n() < Stride)
+        Coverage.n(Stride);
+      
+      //Accumulate the signed area of each line.
+      prim::planar::Vector Origin((prim::number)Left, (prim::number)Top);
+      for(prim::count i = 0; i < Segments.n(); i++)
+        AccumulateClippedLine(Segments[i].a - Origin, Segments[i].b - Origin,
+          (prim::number)w, Rows, Stride);
+      
+      //Composite the coverage of each row onto the page.
+      prim::int32 sr = (prim::int32)(c.R * 255.f + 0.5f);
+      prim::int32 sg = (prim::int32)(c.G * 255.f + 0.5f);
+      prim::int32 sb = (prim::int32)(c.B * 255.f + 0.5f);
+      prim::byte Solid[4] = {(prim::byte)sr, (prim::byte)sg, (prim::byte)sb,
+        255};
+      prim::uint32 SolidValue;
+      prim::Memory::Copy((prim::byte*)&SolidValue, Solid, 4);
+      bool Opaque = c.A >= 1.f;
+      
+      prim::float32* Cover = &Coverage.a();
+      for(prim::count y = 0; y < Rows; y++)
+      {
+        SumRow(&Accumulation[y * Stride], Cover, Stride);
+        prim::byte* Row = &Pixels[((Top + y) * Width + Left) * 4];
+        for(prim::count x = 0; x < w; x++)
+        {
+          if(Cover[x] <= 0.f)
+            continue;
+          
+          //Fill whole spans of full coverage at once.
+          if(Opaque && Cover[x] >= 1.f)
+          {
+            prim::count End = x + 1;
+            while(End < w && Cover[End] >= 1.f)
+              End++;
+            FillSpan((prim::uint32*)&Row[x * 4], End - x, SolidValue);
+            x = End - 1;
+            continue;
+          }
+          
+          prim::int32 Alpha = (prim::int32)(Cover[x] * c.A * 256.f + 0.5f);
+          prim::byte* p = &Row[x * 4];
+          p[0] = (prim::byte)(p[0] + (((sr - p[0]) * Alpha) >> 8));
+          p[1] = (prim::byte)(p[1] + (((sg - p[1]) * Alpha) >> 8));
+          p[2] = (prim::byte)(p[2] + (((sb - p[2]) * Alpha) >> 8));
+          p[3] = (prim::byte)(p[3] + (((255 - p[3]) * Alpha) >> 8));
+        }
+      }
+    }
+    
+    //--------//
+    //Encoding//
+    //--------//
+    
+    ///Computes the CRC-32 of a PNG chunk.
+    static prim::uint32 CRC(const prim::byte* Data, prim::count n,
+      prim::uint32 c = 0xffffffffUL)
+    {
+      //Precomputed for the polynomial 0xedb88320 so that no thread builds it.
+      static const prim::uint32 Table[256] = {
+        0x00000000UL, 0x77073096UL, 0xee0e612cUL, 0x990951baUL,
+        0x076dc419UL, 0x706af48fUL, 0xe963a535UL, 0x9e6495a3UL,
+        0x0edb8832UL, 0x79dcb8a4UL, 0xe0d5e91eUL, 0x97d2d988UL,
+        0x09b64c2bUL, 0x7eb17cbdUL, 0xe7b82d07UL, 0x90bf1d91UL,
+        0x1db71064UL, 0x6ab020f2UL, 0xf3b97148UL, 0x84be41deUL,
+        0x1adad47dUL, 0x6ddde4ebUL, 0xf4d4b551UL, 0x83d385c7UL,
+        0x136c9856UL, 0x646ba8c0UL, 0xfd62f97aUL, 0x8a65c9ecUL,
+        0x14015c4fUL, 0x63066cd9UL, 0xfa0f3d63UL, 0x8d080df5UL,
+        0x3b6e20c8UL, 0x4c69105eUL, 0xd56041e4UL, 0xa2677172UL,
+        0x3c03e4d1UL, 0x4b04d447UL, 0xd20d85fdUL, 0xa50ab56bUL,
+        0x35b5a8faUL, 0x42b2986cUL, 0xdbbbc9d6UL, 0xacbcf940UL,
+        0x32d86ce3UL, 0x45df5c75UL, 0xdcd60dcfUL, 0xabd13d59UL,
+        0x26d930acUL, 0x51de003aUL, 0xc8d75180UL, 0xbfd06116UL,
+        0x21b4f4b5UL, 0x56b3c423UL, 0xcfba9599UL, 0xb8bda50fUL,
+        0x2802b89eUL, 0x5f058808UL, 0xc60cd9b2UL, 0xb10be924UL,
+        0x2f6f7c87UL, 0x58684c11UL, 0xc1611dabUL, 0xb6662d3dUL,
+        0x76dc4190UL, 0x01db7106UL, 0x98d220bcUL, 0xefd5102aUL,
+        0x71b18589UL, 0x06b6b51fUL, 0x9fbfe4a5UL, 0xe8b8d433UL,
+        0x7807c9a2UL, 0x0f00f934UL, 0x9609a88eUL, 0xe10e9818UL,
+        0x7f6a0dbbUL, 0x086d3d2dUL, 0x91646c97UL, 0xe6635c01UL,
+        0x6b6b51f4UL, 0x1c6c6162UL, 0x856530d8UL, 0xf262004eUL,
+        0x6c0695edUL, 0x1b01a57bUL, 0x8208f4c1UL, 0xf50fc457UL,
+        0x65b0d9c6UL, 0x12b7e950UL, 0x8bbeb8eaUL, 0xfcb9887cUL,
+        0x62dd1ddfUL, 0x15da2d49UL, 0x8cd37cf3UL, 0xfbd44c65UL,
+        0x4db26158UL, 0x3ab551ceUL, 0xa3bc0074UL, 0xd4bb30e2UL,
+        0x4adfa541UL, 0x3dd895d7UL, 0xa4d1c46dUL, 0xd3d6f4fbUL,
+        0x4369e96aUL, 0x346ed9fcUL, 0xad678846UL, 0xda60b8d0UL,
+        0x44042d73UL, 0x33031de5UL, 0xaa0a4c5fUL, 0xdd0d7cc9UL,
+        0x5005713cUL, 0x270241aaUL, 0xbe0b1010UL, 0xc90c2086UL,
+        0x5768b525UL, 0x206f85b3UL, 0xb966d409UL, 0xce61e49fUL,
+        0x5edef90eUL, 0x29d9c998UL, 0xb0d09822UL, 0xc7d7a8b4UL,
+        0x59b33d17UL, 0x2eb40d81UL, 0xb7bd5c3bUL, 0xc0ba6cadUL,
+        0xedb88320UL, 0x9abfb3b6UL, 0x03b6e20cUL, 0x74b1d29aUL,
+        0xead54739UL, 0x9dd277afUL, 0x04db2615UL, 0x73dc1683UL,
+        0xe3630b12UL, 0x94643b84UL, 0x0d6d6a3eUL, 0x7a6a5aa8UL,
+        0xe40ecf0bUL, 0x9309ff9dUL, 0x0a00ae27UL, 0x7d079eb1UL,
+        0xf00f9344UL, 0x8708a3d2UL, 0x1e01f268UL, 0x6906c2feUL,
+        0xf762575dUL, 0x806567cbUL, 0x196c3671UL, 0x6e6b06e7UL,
+        0xfed41b76UL, 0x89d32be0UL, 0x10da7a5aUL, 0x67dd4accUL,
+        0xf9b9df6fUL, 0x8ebeeff9UL, 0x17b7be43UL, 0x60b08ed5UL,
+        0xd6d6a3e8UL, 0xa1d1937eUL, 0x38d8c2c4UL, 0x4fdff252UL,
+        0xd1bb67f1UL, 0xa6bc5767UL, 0x3fb506ddUL, 0x48b2364bUL,
+        0xd80d2bdaUL, 0xaf0a1b4cUL, 0x36034af6UL, 0x41047a60UL,
+        0xdf60efc3UL, 0xa867df55UL, 0x316e8eefUL, 0x4669be79UL,
+        0xcb61b38cUL, 0xbc66831aUL, 0x256fd2a0UL, 0x5268e236UL,
+        0xcc0c7795UL, 0xbb0b4703UL, 0x220216b9UL, 0x5505262fUL,
+        0xc5ba3bbeUL, 0xb2bd0b28UL, 0x2bb45a92UL, 0x5cb36a04UL,
+        0xc2d7ffa7UL, 0xb5d0cf31UL, 0x2cd99e8bUL, 0x5bdeae1dUL,
+        0x9b64c2b0UL, 0xec63f226UL, 0x756aa39cUL, 0x026d930aUL,
+        0x9c0906a9UL, 0xeb0e363fUL, 0x72076785UL, 0x05005713UL,
+        0x95bf4a82UL, 0xe2b87a14UL, 0x7bb12baeUL, 0x0cb61b38UL,
+        0x92d28e9bUL, 0xe5d5be0dUL, 0x7cdcefb7UL, 0x0bdbdf21UL,
+        0x86d3d2d4UL, 0xf1d4e242UL, 0x68ddb3f8UL, 0x1fda836eUL,
+        0x81be16cdUL, 0xf6b9265bUL, 0x6fb077e1UL, 0x18b74777UL,
+        0x88085ae6UL, 0xff0f6a70UL, 0x66063bcaUL, 0x11010b5cUL,
+        0x8f659effUL, 0xf862ae69UL, 0x616bffd3UL, 0x166ccf45UL,
+        0xa00ae278UL, 0xd70dd2eeUL, 0x4e048354UL, 0x3903b3c2UL,
+        0xa7672661UL, 0xd06016f7UL, 0x4969474dUL, 0x3e6e77dbUL,
+        0xaed16a4aUL, 0xd9d65adcUL, 0x40df0b66UL, 0x37d83bf0UL,
+        0xa9bcae53UL, 0xdebb9ec5UL, 0x47b2cf7fUL, 0x30b5ffe9UL,
+        0xbdbdf21cUL, 0xcabac28aUL, 0x53b39330UL, 0x24b4a3a6UL,
+        0xbad03605UL, 0xcdd70693UL, 0x54de5729UL, 0x23d967bfUL,
+        0xb3667a2eUL, 0xc4614ab8UL, 0x5d681b02UL, 0x2a6f2b94UL,
+        0xb40bbe37UL, 0xc30c8ea1UL, 0x5a05df1bUL, 0x2d02ef8dUL};
+      for(prim::count i = 0; i < n; i++)
+        c = Table[(c ^ Data[i]) & 0xff] ^ (c >> 8);
+      return c;
+    }
+    
+    ///Writes a big-endian 32-bit integer.
+    static void WriteBigEndian(prim::byte* Out, prim::uint32 v)
+    {
+      Out[0] = (prim::byte)(v >> 24);
+      Out[1] = (prim::byte)(v >> 16);
+      Out[2] = (prim::byte)(v >> 8);
+      Out[3] = (prim::byte)v;
+    }
+    
+    ///Appends a chunk with its length and CRC.
+    static void AppendChunk(prim::String& Out, const prim::ascii* Type,
+      const prim::byte* Data, prim::count n)
+    {
+      prim::byte Header[8], Footer[4];
+      WriteBigEndian(Header, (prim::uint32)n);
+      for(prim::count i = 0; i < 4; i++)
+        Header[4 + i] = (prim::byte)Type[i];
+      WriteBigEndian(Footer, CRC(Data, n, CRC(&Header[4], 4)) ^ 0xffffffffUL);
+      Out.Append(Header, 8);
+      if(n)
+        Out.Append(Data, n);
+      Out.Append(Footer, 4);
+    }
+    
+    /**Compresses data into a zlib stream. Without zlib the data is written as
+    stored blocks, which is valid but not compressed.*/
+    static void Deflate(const prim::Array<prim::byte>& In,
+      prim::Array<prim::byte>& Out, prim::count Level)
+    {
+#ifdef BELLEBONNESAGE_WITH_ZLIB
+      uLongf CompressedSize = compressBound((uLong)In.n());
+      Out.n((prim::count)CompressedSize);
+      if(compress2((Bytef*)&Out.a(), &CompressedSize, (const Bytef*)&In.a(),
+        (uLong)In.n(), (int)prim::Min(prim::Max(Level, (prim::count)1),
+        (prim::count)9)) == Z_OK)
+      {
+        Out.n((prim::count)CompressedSize);
+        return;
+      }
+#else
+      (void)Level;
+#endif
+      const prim::count BlockSize = 65535;
+      prim::count Blocks = (In.n() + BlockSize - 1) / BlockSize;
+      if(!Blocks)
+        Blocks = 1;
+      Out.n(2 + Blocks * 5 + In.n() + 4);
+      prim::byte* o = &Out.a();
+      *o++ = 0x78;
+      *o++ = 0x01;
+      
+      //Write the stored blocks.
+      for(prim::count i = 0, b = 0; b < Blocks; b++, i += BlockSize)
+      {
+        prim::count n = prim::Min(In.n() - i, BlockSize);
+        *o++ = (prim::byte)(b + 1 == Blocks ? 1 : 0);
+        *o++ = (prim::byte)n;
+        *o++ = (prim::byte)(n >> 8);
+        *o++ = (prim::byte)~n;
+        *o++ = (prim::byte)(~n >> 8);
+        if(n)
+          prim::Memory::Copy(o, &In[i], n);
+        o += n;
+      }
+      
+      //Write the Adler-32 checksum, taking the modulus as rarely as possible.
+      prim::uint32 s1 = 1, s2 = 0;
+      for(prim::count i = 0; i < In.n();)
+      {
+        prim::count End = prim::Min(In.n(), i + (prim::count)5552);
+        for(; i < End; i++)
+        {
+          s1 += In[i];
+          s2 += s1;
+        }
+        s1 %= 65521;
+        s2 %= 65521;
+      }
+      WriteBigEndian(o, (s2 << 16) | s1);
+    }
+    
+    ///Encodes the pixels of the current page as a PNG file.
+    void Encode(prim::String& Out)
+    {
+      static const prim::byte Signature[8] =
+        {0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a};
+      Out.Clear();
+      Out.Append(Signature, 8);
+      
+      prim::byte Header[13];
+      WriteBigEndian(&Header[0], (prim::uint32)Width);
+      WriteBigEndian(&Header[4], (prim::uint32)Height);
+      Header[8] = 8; //Bit depth
+      Header[9] = 6; //RGBA
+      Header[10] = 0; //Deflate
+      Header[11] = 0; //Adaptive filtering
+      Header[12] = 0; //No interlace
+      AppendChunk(Out, "IHDR", Header, 13);
+      
+      //Each scanline is preceded by its filter type, which is always none.
+      prim::Array<prim::byte> Raw, Compressed;
+      prim::count RowBytes = Width * 4 + 1;
+      Raw.n(Height * RowBytes);
+      for(prim::count y = 0; y < Height; y++)
+      {
+        Raw[y * RowBytes] = 0;
+        prim::Memory::Copy(&Raw[y * RowBytes + 1], &Pixels[y * Width * 4],
+          Width * 4);
+      }
+      Deflate(Raw, Compressed, PNGProperties->CompressionLevel);
+      AppendChunk(Out, "IDAT", &Compressed.a(), Compressed.n());
+      AppendChunk(Out, "IEND", 0, 0);
+    }
+    
+    ///Clears the page to the background color.
+    void InitializePage(Inches Size)
+    {
+      CurrentSize = Size;
+      Width = prim::Max((prim::count)prim::Ceiling(
+        Size.x * PNGProperties->PixelsPerInch), (prim::count)1);
+      Height = prim::Max((prim::count)prim::Ceiling(
+        Size.y * PNGProperties->PixelsPerInch), (prim::count)1);
+      Pixels.n(Width * Height * 4);
+      
+      const Color& b = PNGProperties->Background;
+      prim::byte Clear[4] = {(prim::byte)(b.R * 255.f + 0.5f),
+        (prim::byte)(b.G * 255.f + 0.5f), (prim::byte)(b.B * 255.f + 0.5f),
+        (prim::byte)(b.A * 255.f + 0.5f)};
+      prim::uint32 ClearValue;
+      prim::Memory::Copy((prim::byte*)&ClearValue, Clear, 4);
+      FillSpan((prim::uint32*)&Pixels.a(), Width * Height, ClearValue);
+    }
+    
+    public:
+    
+    ///Constructor initializes the PNG renderer.
+    PNG() : PNGProperties(0), CachedPortfolio(0), Width(0), Height(0) {}
+
+    ///Calls the paint event of each canvas and encodes it.
+    void Paint(Portfolio* PortfolioToPaint,
+      Painter::Properties* PortfolioProperties)
+    {
+      //Cache the portfolio.
+      CachedPortfolio = PortfolioToPaint;
+      
+      //Get a pointer to the properties.
+      PNGProperties = PortfolioProperties->Interface<Properties>();
+
+      //Clear the output.
+      PNGProperties->Output.RemoveAll();
+      
+      //Go through each canvas and paint it to an image.
+      for(prim::count i = 0; i < CachedPortfolio->Canvases.n(); i++)
+      {
+        //Set the current page number.
+        SetPageNumber(i);
+      
+        //Clear the page.
+        InitializePage(CachedPortfolio->Canvases[i]->Dimensions);
+        
+        //Paint the current canvas.
+        CachedPortfolio->Canvases[i]->Paint(*this, *CachedPortfolio);
+        
+        //Encode the page and add it to the output.
+        Encode(PNGProperties->Output.Add());
+        
+        //Reset the page number to indicate painting is finished.
+        ResetPageNumber();
+      }
+      
+      //Write out to file if a filename stem was provided.
+      for(prim::count i = 0; i < PNGProperties->Output.n(); i++)
+      {
+        prim::String Filename = PNGProperties->FilenameStem;
+        if(!Filename)
+          break;
+        
+        if(PNGProperties->Output.n() > 1)
+          Filename << (i + 1);
+        Filename << ".png";
+        prim::File::Write(Filename, PNGProperties->Output[i]);
+      }
+      
+      //Set the properties pointer back to null to be safe.
+      PNGProperties = 0;
+      
+      //Set the cached portfolio pointer back to null.
+      CachedPortfolio = 0;
+    }
+    
+    ///Returns the pixels of the last page painted as RGBA bytes.
+    const prim::Array<prim::byte>& GetPixels() const
+    {
+      return Pixels;
+    }
+    
+    ///Rasterizes a path onto the current page.
+    void Draw(const Path& p, const Affine& a)
+    {
+      if(!PNGProperties)
+        return;
+      
+      Transform(a);
+      Affine A = PixelSpace();
+      
+      //Fill the path if necessary.
+      if(State.FillColor.A > 0.f)
+      {
+        Segments.Clear();
+        FillOutline Outline(Segments);
+        Flatten(p, A, Outline);
+        Fill(State.FillColor);
+      }
+      
+      //Stroke the path if necessary.
+      prim::number ScaledStrokeWidth = State.StrokeWidth *
+        prim::planar::Vector(A.a, A.d).Mag() / prim::Sqrt(2.0);
+      if(State.StrokeColor.A > 0.f && ScaledStrokeWidth > 0.0)
+      {
+        Segments.Clear();
+        StrokeOutline Outline(Segments, ScaledStrokeWidth * 0.5);
+        Flatten(p, A, Outline);
+        Fill(State.StrokeColor);
+      }
+      
+      Revert();
+    }
+  };
+}}
+#endif
@@ -39,6 +39,8 @@
 #ifndef BELLEBONNESAGE_PAINTERS_SVG_H
 #define BELLEBONNESAGE_PAINTERS_SVG_H
 
+#include "NumberWriter.h"
+
 namespace bellebonnesage { namespace painters
 {
   class SVG : public Painter
@@ -55,9 +57,33 @@ namespace bellebonnesage { namespace painters
       one page, then only .svg will be appended.*/
       prim::String FilenameStem;
       
+      ///Number of decimal places written for path coordinates.
+      prim::count Precision;
+      
+      /**Whether finished pages are kept in Output. When false, each page is
+      only handed to PageFinished() and then discarded, so that long scores
+      do not have to be held in memory.*/
+      bool KeepOutput;
+      
       public:
       
-      Properties() {}
+      Properties() : Precision(5), KeepOutput(true) {}
+      
+      /**Called as soon as each page has been painted. By default the page is
+      written to a file if a filename stem was provided. Override this to
+      stream pages somewhere else, for example to a network connection.*/
+      virtual void PageFinished(prim::count PageIndex, prim::count PageCount,
+        const prim::String& Page)
+      {
+        if(!FilenameStem)
+          return;
+        
+        prim::String Filename = FilenameStem;
+        if(PageCount > 1)
+          Filename << (PageIndex + 1);
+        Filename << ".svg";
+        prim::File::Write(Filename, Page);
+      }
 
       friend class SVG;
     };
@@ -75,6 +101,15 @@ namespace bellebonnesage { namespace painters
     
     ///Dimensions of the current SVG page.
     Inches CurrentSize;
+    
+    ///Symbol definitions for the shared paths used on the current page.
+    prim::String CurrentSVGDefs;
+    
+    ///Looks up the symbol number of each shared path on the current page.
+    prim::Table<const Path*, prim::count> SymbolIndex;
+    
+    ///Number of symbols defined on the current page.
+    prim::count SymbolCount;
 
     ///Initializes the SVG page with header information.
     void InitializeSVGPage(Inches Size)
@@ -87,6 +122,7 @@ namespace bellebonnesage { namespace painters
       SVG++;
       SVG >> "<svg ";
       SVG >> "  xmlns=\"http://www.w3.org/2000/svg\"";
+      SVG >> "  xmlns:xlink=\"http://www.w3.org/1999/xlink\"";
       SVG >> "  version=\"1.1\"";
       SVG >> "  width=\"" << Size.x << "in\"";
       SVG >> "  height=\"" << Size.y << "in\"";
@@ -96,18 +132,88 @@ namespace bellebonnesage { namespace painters
       SVG >> "<!--Path data for each glyph-->";
       CurrentSVGPage = SVG;
       CurrentSize = Size;
+      
+      //Each page is a standalone file, so symbols are defined per page.
+      CurrentSVGDefs = "";
+      SymbolIndex.Clear();
+      SymbolCount = 0;
     }
     
-    ///Finalizes the SVG page by closing the svg tag.
+    ///Finalizes the SVG page by writing the symbols and closing the svg tag.
     void FinalizeSVGPage()
     {
+      if(SymbolCount)
+      {
+        CurrentSVGPage >> "<defs>";
+        CurrentSVGPage >> CurrentSVGDefs;
+        CurrentSVGPage >> "</defs>";
+      }
       CurrentSVGPage >> "</svg>";
     }
     
+    ///Returns the affine transform from the current space to SVG space.
+    Affine PageSpace()
+    {
+      Affine B = Affine::Scale(prim::planar::Vector(1.0, -1.0)) *
+        Affine::Translate(prim::planar::Vector(0, -CurrentSize.y));
+      return B * CurrentSpace();
+    }
+    
+    ///Writes the path data of a path transformed by an affine matrix.
+    void AppendPathData(prim::String& SVG, const Path& p, const Affine& A)
+    {
+      NumberWriter w(SVG, SVGProperties->Precision);
+      for(prim::count j = 0; j < p.n(); j++)
+      {
+        const Instruction& i = p[j];
+        prim::planar::Vector c1 = i.Control1(), c2 = i.Control2(),
+          e = i.End();
+        c1 = A << c1;
+        c2 = A << c2;
+        e = A << e;
+        
+        if(i.IsMove())
+          w << " M " << e.x << ' ' << e.y;
+        else if(i.IsLine())
+          w << " L " << e.x << ' ' << e.y;
+        else if(i.IsCubic())
+          w << " C " << c1.x << ' ' << c1.y << ' ' <<
+            c2.x << ' ' << c2.y << ' ' << e.x << ' ' << e.y;
+        else
+          w << " Z";
+      }
+    }
+    
+    ///Writes the fill and stroke attributes for the current raster state.
+    void AppendStyle(prim::String& SVG, prim::number StrokeWidth)
+    {
+      if(State.FillColor.A)
+      {
+        SVG << " fill=\"rgb(" <<
+          prim::Round(State.FillColor.R * 255.0) << ", " <<
+          prim::Round(State.FillColor.G * 255.0) << ", " <<
+          prim::Round(State.FillColor.B * 255.0) << ")\"";
+      }
+      else
+        SVG << " fill=\"none\"";
+
+      if(StrokeWidth > 0.0)
+      {
+        SVG << " style=\"stroke:rgb(" <<
+          prim::Round(State.StrokeColor.R * 255.0) << ", " <<
+          prim::Round(State.StrokeColor.G * 255.0) << ", " <<
+          prim::Round(State.StrokeColor.B * 255.0) << "); "
+          "stroke-width: " << StrokeWidth << "\"";
+      }
+      else
+        SVG << " style=\"stroke:none; stroke-width:0\"";
+    }
+    
     public:
     
     ///Constructor initializes the JUCE renderer.
-    SVG() : SVGProperties(0), CachedPortfolio(0) {}
+    SVG() : SVGProperties(0), CachedPortfolio(0), SymbolIndex(-1),
+      SymbolCount(0) {}
 
     ///Calls the paint event of the current canvas being painted.
     void Paint(Portfolio* PortfolioToPaint,
@@ -137,26 +243,17 @@ namespace bellebonnesage { namespace painters
         //Finalizes the SVG header.
         FinalizeSVGPage();
         
-        //Add the SVG page to the output.
-        SVGProperties->Output.Add() = CurrentSVGPage;
+        //Hand the finished page off and add it to the output.
+        SVGProperties->PageFinished(i, CachedPortfolio->Canvases.n(),
+          CurrentSVGPage);
+        if(SVGProperties->KeepOutput)
+          SVGProperties->Output.Add() = CurrentSVGPage;
+        CurrentSVGPage = "";
         
         //Reset the page number to indicate painting is finished.
         ResetPageNumber();
       }
       
-      //Write out to file if a filename stem was provided.
-      for(prim::count i = 0; i < SVGProperties->Output.n(); i++)
-      {
-        prim::String Filename = SVGProperties->FilenameStem;
-        if(!Filename)
-          break;
-        
-        if(SVGProperties->Output.n() > 1)
-          Filename << (i + 1);
-        Filename << ".svg";
-        prim::File::Write(Filename, SVGProperties->Output[i]);
-      }
-      
       //Set the properties pointer back to null to be safe.
       SVGProperties = 0;
       
@@ -168,58 +265,47 @@ namespace bellebonnesage { namespace painters
     void Draw(const Path& p, const Affine& a)
     {
       Transform(a);
-      Affine B = Affine::Scale(prim::planar::Vector(1.0, -1.0)) *
-        Affine::Translate(prim::planar::Vector(0, -CurrentSize.y));
-      Affine A = B * CurrentSpace();
+      Affine A = PageSpace();
       
       prim::String SVG;
       SVG >> "<path";
       SVG << " d=\"";
-      for(prim::count j = 0; j < p.n(); j++)
-      {
-        const Instruction& i = p[j];
-        prim::planar::Vector c1 = i.Control1(), c2 = i.Control2(), e = i.End();
-        c1 = A << c1;
-        c2 = A << c2;
-        e = A << e;
-        
-        if(i.IsMove())
-          SVG << " M " << e.x << " " << e.y;
-        else if(i.IsLine())
-          SVG << " L " << e.x << " " << e.y;
-        else if(i.IsCubic())
-          SVG << " C " << c1.x << " " << c1.y << " " <<
-            c2.x << " " << c2.y << " " << e.x << " " << e.y;
-        else
-          SVG << " Z";
-      }
+      AppendPathData(SVG, p, A);
       SVG << "\"";
-      
-      
-      if(State.FillColor.A)
+      AppendStyle(SVG, State.StrokeWidth *
+        prim::planar::Vector(A.a, A.d).Mag() / prim::Sqrt(2.0));
+      SVG << "/>";
+      CurrentSVGPage >> SVG;
+      Revert();
+    }
+    
+    /**Draws a shared path by defining it once per page as a symbol and then
+    referencing the symbol each time the path is drawn.*/
+    void DrawShared(const Path& p, const Affine& a)
+    {
+      //Define the symbol in its own coordinates the first time it is used.
+      prim::count& Index = SymbolIndex[&p];
+      if(Index < 0)
       {
-        SVG << " fill=\"rgb(" <<
-          prim::Round(State.FillColor.R * 255.0) << ", " <<
-          prim::Round(State.FillColor.G * 255.0) << ", " <<
-          prim::Round(State.FillColor.B * 255.0) << ")\"";
+        Index = SymbolCount++;
+        CurrentSVGDefs >> "<symbol id=\"s" << Index <<
+          "\" overflow=\"visible\"><path d=\"";
+        AppendPathData(CurrentSVGDefs, p, Affine::Unit());
+        CurrentSVGDefs << "\"/></symbol>";
       }
-      else
-        SVG << " fill=\"none\"";
-
-      prim::number ScaledStrokeWidth = State.StrokeWidth *
-          prim::planar::Vector(A.a, A.d).Mag() /
-          prim::Sqrt(2.0);
-      if(ScaledStrokeWidth > 0.0)
+      
+      //Reference the symbol, letting it inherit the fill and stroke.
+      Transform(a);
+      Affine A = PageSpace();
+      prim::String SVG;
+      SVG >> "<use xlink:href=\"#s" << Index << "\" transform=\"matrix(";
       {
-        SVG << " style=\"stroke:rgb(" <<
-          prim::Round(State.StrokeColor.R * 255.0) << ", " <<
-          prim::Round(State.StrokeColor.G * 255.0) << ", " <<
-          prim::Round(State.StrokeColor.B * 255.0) << "); "
-          "stroke-width: " << ScaledStrokeWidth << "\"";
+        NumberWriter w(SVG, SVGProperties->Precision);
+        w << A.a << ' ' << A.b << ' ' << A.c << ' ' << A.d << ' ' <<
+          A.e << ' ' << A.f;
       }
-      else
-        SVG << " style=\"stroke:none; stroke-width:0\"";
-        
+      SVG << ")\"";
+      AppendStyle(SVG, State.StrokeWidth);
       SVG << "/>";
       CurrentSVGPage >> SVG;
       Revert();
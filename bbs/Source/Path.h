@@ -137,23 +137,183 @@ namespace bellebonnesage
     }
   };
 
-#if defined(JUCE_VERSION)
-  //Inherit native path base classes.
-  class Path : public juce::Path
-#else
   ///Vector path object
   class Path
-#endif
   {
-    prim::Array<Instruction> Instructions;
-    prim::Array<prim::planar::Polygon> CachedOutline;
-    prim::planar::Rectangle BoundingBox;
+    /**Geometry of a path along with caches derived from it. Copies of a path
+    share the same geometry, which is copied when one of them is changed.*/
+    struct Geometry
+    {
+      ///Construction type of each instruction.
+      prim::Array<prim::byte> Verbs;
+      
+      ///Index of the first coordinate of each instruction.
+      prim::Array<prim::uint32> Offsets;
+      
+      /**Packed coordinates of the instructions. Moves and lines store the end
+      point, and cubics store both control points followed by the end point.*/
+      prim::Array<prim::float32> Coordinates;
+      
+      /**Geometry in use, which is either the arrays above or data stored
+      outside of the path such as a memory-mapped font.*/
+      const prim::byte* VerbData;
+      const prim::uint32* OffsetData;
+      const prim::float32* CoordinateData;
+      prim::count Instructions;
+      prim::count CoordinateCount;
+      
+      ///Whether the geometry in use is stored outside of the path.
+      bool External;
+      
+      prim::planar::Rectangle BoundingBox;
+      
+      ///Whether the polygon outline has been built.
+      bool HasOutline;
+      
+      ///Polygon outline of the path including control points.
+      prim::Array<prim::planar::Polygon> Outline;
+      
+#if defined(JUCE_VERSION)
+      ///Whether the native path has been built.
+      bool HasNative;
+      
+      ///Native JUCE version of the path.
+      juce::Path Native;
+      
+      Geometry() : VerbData(0), OffsetData(0), CoordinateData(0),
+        Instructions(0), CoordinateCount(0), External(false),
+        HasOutline(false), HasNative(false) {}
+#else
+      Geometry() : VerbData(0), OffsetData(0), CoordinateData(0),
+        Instructions(0), CoordinateCount(0), External(false),
+        HasOutline(false) {}
+#endif
+      
+      ///Uses the arrays after they have changed.
+      void Own()
+      {
+        VerbData = Verbs.n() ? &Verbs.a() : 0;
+        OffsetData = Offsets.n() ? &Offsets.a() : 0;
+        CoordinateData = Coordinates.n() ? &Coordinates.a() : 0;
+        Instructions = Verbs.n();
+        CoordinateCount = Coordinates.n();
+        External = false;
+      }
+      
+      ///Copies the geometry of another path without its derived caches.
+      void CopyFrom(const Geometry& Other)
+      {
+        Verbs.n(Other.Instructions);
+        Offsets.n(Other.Instructions);
+        Coordinates.n(Other.CoordinateCount);
+        if(Other.Instructions)
+        {
+          prim::Memory::Copy(&Verbs.a(), Other.VerbData, Other.Instructions);
+          prim::Memory::Copy(&Offsets.a(), Other.OffsetData,
+            Other.Instructions);
+        }
+        if(Other.CoordinateCount)
+          prim::Memory::Copy(&Coordinates.a(), Other.CoordinateData,
+            Other.CoordinateCount);
+        BoundingBox = Other.BoundingBox;
+        Own();
+      }
+      
+      ///Discards the derived caches after the geometry has changed.
+      void ClearDerived()
+      {
+        if(HasOutline)
+        {
+          Outline.Clear();
+          HasOutline = false;
+        }
+#if defined(JUCE_VERSION)
+        if(HasNative)
+        {
+          Native.clear();
+          HasNative = false;
+        }
+#endif
+      }
+    };
+    
+    ///Geometry of the path, shared between copies until one is changed.
+    mutable prim::Pointer<Geometry> Data;
+    
+    ///Returns the geometry for reading, creating it if necessary.
+    Geometry& Get() const
+    {
+      if(!Data)
+        Data = new Geometry;
+      return *Data;
+    }
+    
+    /**Returns the geometry for writing. If it is shared with other copies or
+    stored outside of the path then this path is given its own copy first.*/
+    Geometry& Mutate()
+    {
+      if(Data && (Data.n() > 1 || Data->External))
+      {
+        prim::Pointer<Geometry> Shared = Data;
+        Data = new Geometry;
+        Data->CopyFrom(*Shared);
+      }
+      Geometry& g = Get();
+      g.ClearDerived();
+      return g;
+    }
+    
+    ///Returns the point at a coordinate index.
+    inline prim::planar::Vector PointAt(prim::count i) const
+    {
+      const prim::float32* c = Data->CoordinateData;
+      return prim::planar::Vector((prim::number)c[i], (prim::number)c[i + 1]);
+    }
+    
+    ///Packs a point into the coordinates.
+    static void AddPoint(Geometry& g, prim::planar::Vector p)
+    {
+      g.Coordinates.Add() = (prim::float32)p.x;
+      g.Coordinates.Add() = (prim::float32)p.y;
+      g.BoundingBox = g.BoundingBox + prim::planar::Vector(
+        (prim::number)g.Coordinates.z(1), (prim::number)g.Coordinates.z());
+    }
     
     public:
     
     ///Default constructor
     Path() {}
     
+    ///Copy constructor shares the geometry with the original.
+    Path(const Path& Other) : Data(Other.Data) {}
+    
+    ///Assignment operator shares the geometry with the original.
+    Path& operator = (const Path& Other)
+    {
+      Data = Other.Data;
+      return *this;
+    }
+    
+    /**Replaces the path with a copy of another path that shares no geometry
+    with it, so the two can be used on different threads.*/
+    void CopyFrom(const Path& Other)
+    {
+      if(!Other.Data)
+      {
+        Data = prim::Pointer<Geometry>();
+        return;
+      }
+      Geometry* g = new Geometry;
+      g->CopyFrom(*Other.Data);
+      Data = g;
+    }
+    
+    ///Returns whether the geometry is shared with another copy of the path.
+    bool IsShared() const
+    {
+      return Data && Data.n() > 1;
+    }
+    
     ///Constructs a transformed copy of a path.
     Path(const Path& p, Affine a)
     {
@@ -163,8 +323,15 @@ namespace bellebonnesage
     ///Appends a transformed copy of a path.
     void Append(const Path& p, Affine a = Affine::Unit())
     {
-      for(prim::count i = 0; i < p.Instructions.n(); i++)
-        Add(Instruction(p.Instructions[i], a));      
+      //Share the geometry if this would otherwise be an exact copy.
+      if(!n() && a == Affine::Unit())
+      {
+        Data = p.Data;
+        return;
+      }
+      
+      for(prim::count i = 0; i < p.n(); i++)
+        Add(Instruction(p[i], a));      
     }
     
     ///Appends a transformed copy of a polygon.
@@ -210,75 +377,108 @@ namespace bellebonnesage
       }
     }
     
-    ///Adds instruction and updates bounding box, polygon, and native base path.
+    /**Adds an instruction and updates the bounding box. The outline and native
+    path are rebuilt the next time they are needed.*/
     void Add(const Instruction& i)
     {
-      prim::planar::Vector e = i.End();
-      prim::planar::Vector c1 = i.Control1();
-      prim::planar::Vector c2 = i.Control2();
-      
-      Instructions.Add() = i;
-      
+      Geometry& g = Mutate();
+      g.Offsets.Add() = (prim::uint32)g.Coordinates.n();
       if(i.IsMove())
-      {
-        CachedOutline.Add().Add() = e;
-        BoundingBox = BoundingBox + e;
-      }
+        g.Verbs.Add() = 1;
       else if(i.IsLine())
+        g.Verbs.Add() = 2;
+      else if(i.IsCubic())
       {
-        CachedOutline.z().Add() = e;
-        BoundingBox = BoundingBox + e;
-      }
-      else if(i.HasControls())
-      {
-        CachedOutline.z().Add() = c1;
-        CachedOutline.z().Add() = c2;
-        CachedOutline.z().Add() = e;
-        BoundingBox = BoundingBox + c1 + c2 + e;
+        g.Verbs.Add() = 3;
+        AddPoint(g, i.Control1());
+        AddPoint(g, i.Control2());
       }
+      else
+        g.Verbs.Add() = 4;
+      
+      if(i.HasEnd())
+        AddPoint(g, i.End());
+      g.Own();
+    }
     
-      //Do work for native path base classes.
-#if defined(JUCE_VERSION)
-      if(i.IsMove())
-        startNewSubPath((float)e.x, (float)e.y);
-      else if(i.IsLine())
-        lineTo((float)e.x, (float)e.y);
-      else if(i.IsCubic())
-        cubicTo((float)c1.x, (float)c1.y, (float)c2.x, (float)c2.y,
-          (float)e.x, (float)e.y);
-      else if(i.IsClosing())
-        closeSubPath();
-#endif
+    /**Uses geometry stored outside of the path without copying it. The verbs
+    are 1 for move-to, 2 for line-to, 3 for cubic-to and 4 for close-path, and
+    the offsets and coordinates are packed as the path stores them. The data
+    must stay valid and unchanged while the path or any copy of it uses it. If
+    the path is later changed then it copies the data first.*/
+    void Refer(const prim::byte* Verbs, const prim::uint32* Offsets,
+      prim::count Instructions, const prim::float32* Coordinates,
+      prim::count CoordinateCount, prim::planar::Rectangle Bounds)
+    {
+      Data = new Geometry;
+      Data->VerbData = Verbs;
+      Data->OffsetData = Offsets;
+      Data->CoordinateData = Coordinates;
+      Data->Instructions = Instructions;
+      Data->CoordinateCount = CoordinateCount;
+      Data->External = true;
+      Data->BoundingBox = Bounds;
+    }
+    
+    ///Returns the construction type of each instruction as used by Refer().
+    const prim::byte* PackedVerbs() const
+    {
+      return Data ? Data->VerbData : 0;
+    }
+    
+    ///Returns the index of the first coordinate of each instruction.
+    const prim::uint32* PackedOffsets() const
+    {
+      return Data ? Data->OffsetData : 0;
+    }
+    
+    ///Returns the packed coordinates of the instructions.
+    const prim::float32* PackedCoordinates() const
+    {
+      return Data ? Data->CoordinateData : 0;
+    }
+    
+    ///Returns the number of packed coordinates.
+    prim::count PackedCoordinateCount() const
+    {
+      return Data ? Data->CoordinateCount : 0;
     }
     
     ///Retrieves the i-th path construction.
-    inline const Instruction& operator [] (prim::count i) const
+    inline Instruction operator [] (prim::count i) const
     {
-      return Instructions[i];
+      prim::count o = (prim::count)Data->OffsetData[i];
+      switch(Data->VerbData[i])
+      {
+        case 1: return Instruction(PointAt(o), true);
+        case 2: return Instruction(PointAt(o));
+        case 3: return Instruction(PointAt(o), PointAt(o + 2), PointAt(o + 4));
+      }
+      return Instruction();
     }
     
     ///Retrieves the i-th path construction.
-    inline const Instruction& ith(prim::count i) const
+    inline Instruction ith(prim::count i) const
     {
-      return Instructions[i];
+      return (*this)[i];
     }
     
     ///Retrieves the number of path constructions.
     inline prim::count n() const
     {
-      return Instructions.n();
+      return Data ? Data->Instructions : 0;
     }
     
     ///Retrieves the first path construction.
-    inline const Instruction& a() const
+    inline Instruction a() const
     {
-      return Instructions.a();
+      return (*this)[0];
     }
     
     ///Retrieves the last path construction.
-    inline const Instruction& z(prim::count ItemsFromEnd = 0) const
+    inline Instruction z(prim::count ItemsFromEnd = 0) const
     {
-      return Instructions.z(ItemsFromEnd);
+      return (*this)[n() - 1 - ItemsFromEnd];
     }
     
     ///Retrieves the current end point.
@@ -290,32 +490,99 @@ namespace bellebonnesage
         return prim::planar::Vector();
     }
     
-    ///Retrieves the cached polygon outline of this path.
-    inline const prim::Array<prim::planar::Polygon>& Outline() const
+    /**Retrieves the polygon outline of this path. Each subpath is a polygon of
+    its points, including the control points of cubics.*/
+    const prim::Array<prim::planar::Polygon>& Outline() const
+    {
+      Geometry& c = Get();
+      if(!c.HasOutline)
+      {
+        for(prim::count i = 0; i < n(); i++)
+        {
+          prim::count o = (prim::count)c.OffsetData[i];
+          if(c.VerbData[i] == 1 || !c.Outline.n())
+            c.Outline.Add();
+          if(c.VerbData[i] == 3)
+          {
+            c.Outline.z().Add() = PointAt(o);
+            c.Outline.z().Add() = PointAt(o + 2);
+            c.Outline.z().Add() = PointAt(o + 4);
+          }
+          else if(c.VerbData[i] != 4)
+            c.Outline.z().Add() = PointAt(o);
+        }
+        c.HasOutline = true;
+      }
+      return c.Outline;
+    }
+    
+#if defined(JUCE_VERSION)
+    ///Retrieves the native JUCE version of this path.
+    const juce::Path& Native() const
     {
-      return CachedOutline;
+      Geometry& c = Get();
+      if(!c.HasNative)
+      {
+        for(prim::count i = 0; i < n(); i++)
+        {
+          const prim::float32* p = &c.CoordinateData[c.OffsetData[i]];
+          if(c.VerbData[i] == 1)
+            c.Native.startNewSubPath(p[0], p[1]);
+          else if(c.VerbData[i] == 2)
+            c.Native.lineTo(p[0], p[1]);
+          else if(c.VerbData[i] == 3)
+            c.Native.cubicTo(p[0], p[1], p[2], p[3], p[4], p[5]);
+          else
+            c.Native.closeSubPath();
+        }
+        c.HasNative = true;
+      }
+      return c.Native;
+    }
+#endif
+    
+    /**Returns the approximate number of bytes used by the path, including
+    any derived caches that have been built. Geometry shared with other copies
+    of the path is divided evenly between them, and geometry stored outside of
+    the path is not counted.*/
+    prim::count Bytes() const
+    {
+      prim::count b = (prim::count)sizeof(Path);
+      if(!Data)
+        return b;
+      
+      const Geometry& g = *Data;
+      prim::count Shared = (prim::count)sizeof(Geometry) + g.Verbs.n() +
+        g.Offsets.n() * (prim::count)sizeof(prim::uint32) +
+        g.Coordinates.n() * (prim::count)sizeof(prim::float32);
+      for(prim::count i = 0; i < g.Outline.n(); i++)
+        Shared += g.Outline[i].n() * (prim::count)sizeof(prim::planar::Vector);
+#if defined(JUCE_VERSION)
+      //JUCE stores a marker and the coordinates of each element as floats.
+      if(g.HasNative)
+        Shared += (g.Instructions + g.CoordinateCount) *
+          (prim::count)sizeof(float);
+#endif
+      return b + Shared / Data.n();
     }
     
     ///Retrieves the cached bounding box for this path.
     inline prim::planar::Rectangle Bounds() const
     {
-      return BoundingBox;
+      return Data ? Data->BoundingBox : prim::planar::Rectangle();
     }
     
-    ///Retrieves the bounding box of the transformed path box.
+    /**Retrieves the bounding box of the transformed path box. This is exact
+    for translations and scales, and otherwise contains the transformed path.*/
     prim::planar::Rectangle Bounds(const Affine& Transformation) const
     {
-      prim::planar::Rectangle rt;
-      rt = rt + (Transformation << BoundingBox.BottomLeft());
-      rt = rt + (Transformation << BoundingBox.TopLeft());
-      rt = rt + (Transformation << BoundingBox.TopRight());
-      rt = rt + (Transformation << BoundingBox.BottomRight());
-      return rt;
+      return Transformation << Bounds();
     }
     
     ///Retrieves the rectangular polygon box of the transformed path's box.
     prim::planar::Polygon BoundsPolygon(const Affine& Transformation) const
     {
+      prim::planar::Rectangle BoundingBox = Bounds();
       prim::planar::Polygon p;
       p.n(4);
       p[0] = Transformation << BoundingBox.BottomLeft();
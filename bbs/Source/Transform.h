@@ -264,6 +264,32 @@ namespace bellebonnesage
       return -(*this) << Transformed;
     }
     
+    /**Returns the bounding box of a transformed rectangle. If the matrix maps
+    rectangles to rectangles (as with translating, scaling, and rotating by
+    multiples of 90 degrees) then only two corners are transformed and the box
+    is exact. Otherwise it is the box around all four transformed corners.*/
+    prim::planar::Rectangle operator << (
+      const prim::planar::Rectangle& Untransformed) const
+    {
+      if(Untransformed.IsEmpty())
+        return prim::planar::Rectangle();
+      
+      if(IsRectilinear())
+      {
+        prim::planar::Rectangle r(*this << Untransformed.BottomLeft(),
+          *this << Untransformed.TopRight());
+        r.Order();
+        return r;
+      }
+      
+      prim::planar::Rectangle r;
+      r = r + (*this << Untransformed.BottomLeft());
+      r = r + (*this << Untransformed.TopLeft());
+      r = r + (*this << Untransformed.TopRight());
+      r = r + (*this << Untransformed.BottomRight());
+      return r;
+    }
+    
     //----------//
     //Properties//
     //----------//
@@ -279,6 +305,15 @@ namespace bellebonnesage
       return CalculateDeterminant() != (prim::number)0.0;
     }
     
+    /**Returns whether the matrix keeps the sides of a rectangle parallel to
+    the axes. This is true for any combination of translating, scaling, and
+    rotating by multiples of 90 degrees.*/
+    inline bool IsRectilinear() const
+    {
+      return (b == (prim::number)0.0 && c == (prim::number)0.0) ||
+        (a == (prim::number)0.0 && d == (prim::number)0.0);
+    }
+    
     /**Determines if there is a rotation that is not a multiple of 90 degrees.
     Assumes that the matrix does not have a skewing operation. The detection of
     rotation is approximate due to floating point error, so the method is not
@@ -302,9 +337,71 @@ namespace bellebonnesage
     }
   };
   
-  ///Use List::Push() and List::Pop() to add and remove transformations.
-  struct AffineStack : public prim::List<Affine>
+  /**Stack of affine transformations. Use Push() and Pop() to add and remove
+  transformations. The transformations are kept in a contiguous array along
+  with the composition of the stack at each level, so the forwards and
+  backwards transformations do not need to multiply the whole stack.*/
+  class AffineStack
   {
+    ///The transformations on the stack.
+    prim::Array<Affine> Matrices;
+    
+    ///Composition of the transformations up to and including each level.
+    prim::Array<Affine> Composed;
+    
+    /**Number of transformations on the stack. The arrays are never shrunk so
+    that pushing and popping do not reallocate.*/
+    prim::count Depth;
+    
+    public:
+    
+    ///Returns the number of transformations on the stack.
+    prim::count n() const
+    {
+      return Depth;
+    }
+    
+    ///Returns the i-th transformation from the bottom of the stack.
+    const Affine& ith(prim::count i) const
+    {
+      return Matrices[i];
+    }
+    
+    ///Returns the transformation at the bottom of the stack.
+    const Affine& a() const
+    {
+      return Matrices[0];
+    }
+    
+    ///Returns the transformation at the top of the stack.
+    const Affine& z() const
+    {
+      return Matrices[Depth - 1];
+    }
+    
+    ///Pushes a transformation onto the stack.
+    void Push(const Affine& a)
+    {
+      if(Depth == Matrices.n())
+      {
+        Matrices.n(Depth + 1);
+        Composed.n(Depth + 1);
+      }
+      
+      /*The bottom transformation is the starting space, so it is not part of
+      the composition.*/
+      Matrices[Depth] = a;
+      Composed[Depth] = Depth ? Composed[Depth - 1] * a : Affine::Unit();
+      Depth++;
+    }
+    
+    ///Removes the transformation at the top of the stack.
+    void Pop()
+    {
+      if(Depth)
+        Depth--;
+    }
+    
     /**Collapses a range of affine matrices into a single matrix. This method
     effectively translates one space into another. Often Forwards() or
     Backwards() are useful shortcuts to translate between the whole set of
@@ -320,7 +417,12 @@ namespace bellebonnesage
       //Begin with identity matrix.
       Affine M;
 
-      if(Start < End)
+      if(Start == 0 && End > 0)
+      {
+        //Use the stored composition from the beginning space.
+        M = Composed[End];
+      }
+      else if(Start < End)
       {
         //Traverse forward and compute matrix.
         for(prim::count i = Start + 1; i <= End; i++)
@@ -339,7 +441,7 @@ namespace bellebonnesage
     ///Creates a matrix to transform from the beginning space to the end space.
     Affine Forwards() const
     {
-      return Collapse(0, n() - 1);
+      return Depth ? Composed[Depth - 1] : Affine::Unit();
     }
 
     ///Creates a matrix to transform from the end space to the beginning space.
@@ -354,7 +456,7 @@ namespace bellebonnesage
     }
     
     ///Default constructor begins with an identity matrix.
-    AffineStack()
+    AffineStack() : Depth(0)
     {
       //Push identity matrix to the stack.
       Push(Affine::Unit());